@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "ai.h"
+#include "history.h"
+
+// Microbenchmarks for the board, evaluation, AI and history primitives.
+// Each benchmark is calibrated so one repetition takes roughly the target
+// time, warmed up, then repeated; ns/op is reported as min/median/p99 over
+// the repetitions.
+
+#define WARMUP_REPETITIONS 3
+#define DEFAULT_REPETITIONS 31
+#define DEFAULT_TARGET_NS 2000000ULL   // 2 ms per repetition
+
+typedef void (*BenchFn)(void *context, long iterations);
+
+typedef struct {
+    int repetitions;
+    unsigned long long target_ns;
+    const char *filter;
+} BenchConfig;
+
+// Positions used by the board/evaluation/AI benchmarks, from opening to late middle game
+static const char *BENCH_POSITIONS[] = {
+    "",
+    "4",
+    "4453",
+    "4444433",
+    "43443555",
+    "44444412222213",
+    "444444333333555555",
+    "12345671234567123456",
+};
+
+#define BENCH_POSITION_COUNT ((int)(sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0])))
+
+typedef struct {
+    Board boards[BENCH_POSITION_COUNT];
+    CellState to_move[BENCH_POSITION_COUNT];
+    AILevel level;
+} PositionSet;
+
+// Written by every benchmark so the compiler cannot drop the measured work
+static volatile long long sink;
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static unsigned long long time_iterations(BenchFn fn, void *context, long iterations) {
+    unsigned long long start = now_ns();
+    fn(context, iterations);
+    return now_ns() - start;
+}
+
+// `ops_per_iteration` lets one iteration cover a whole position set
+static void run_benchmark(const BenchConfig *config, const char *name, BenchFn fn,
+                          void *context, long ops_per_iteration) {
+    if (config->filter != NULL && strstr(name, config->filter) == NULL) {
+        return;
+    }
+
+    // Double the iteration count until one repetition reaches the target time
+    long iterations = 1;
+    while (time_iterations(fn, context, iterations) < config->target_ns && iterations < (1L << 30)) {
+        iterations = iterations * 2;
+    }
+
+    for (int i = 0; i < WARMUP_REPETITIONS; i++) {
+        time_iterations(fn, context, iterations);
+    }
+
+    double *samples = (double *)malloc((size_t)config->repetitions * sizeof(double));
+    if (samples == NULL) {
+        fprintf(stderr, "connect4_bench: out of memory\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < config->repetitions; i++) {
+        unsigned long long elapsed = time_iterations(fn, context, iterations);
+        samples[i] = (double)elapsed / (double)(iterations * ops_per_iteration);
+    }
+
+    qsort(samples, (size_t)config->repetitions, sizeof(double), compare_double);
+
+    int p99_index = (config->repetitions * 99 + 99) / 100 - 1;
+    printf("%-28s %12.1f %12.1f %12.1f %12ld\n",
+           name,
+           samples[0],
+           samples[config->repetitions / 2],
+           samples[p99_index],
+           iterations * ops_per_iteration);
+
+    free(samples);
+}
+
+/* board primitives */
+
+static void bench_drop_piece(void *context, long iterations) {
+    const PositionSet *set = (const PositionSet *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        for (int p = 0; p < BENCH_POSITION_COUNT; p++) {
+            Board board = set->boards[p];
+            total += board_drop_piece(&board, (int)((i + p) % COLS), set->to_move[p]);
+        }
+    }
+    sink = total;
+}
+
+static void bench_check_winner(void *context, long iterations) {
+    const PositionSet *set = (const PositionSet *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        for (int p = 0; p < BENCH_POSITION_COUNT; p++) {
+            total += board_check_winner(&set->boards[p], set->to_move[p]);
+        }
+    }
+    sink = total;
+}
+
+/* batched win checks, the way parallel rollouts would run them */
+
+#define BATCH_BOARDS 256
+
+typedef struct {
+    Board boards[BATCH_BOARDS];
+    CellState winners[BATCH_BOARDS];
+} BoardBatch;
+
+// Random games cut off after 8 to 41 moves, or at their win
+static void build_batch(BoardBatch *batch) {
+    unsigned int seed = 2024;
+
+    for (int i = 0; i < BATCH_BOARDS; i++) {
+        Board *board = &batch->boards[i];
+        CellState player = PLAYER1;
+        board_init(board);
+        int moves = 8 + i % 34;
+        for (int m = 0; m < moves && !board_is_full(board); m++) {
+            seed = seed * 1103515245u + 12345u;
+            int col = (int)((seed >> 16) % COLS);
+            if (board_drop_piece(board, col, player) < 0) {
+                continue;
+            }
+            if (board_check_winner(board, player)) {
+                break;
+            }
+            player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+        }
+    }
+}
+
+static void bench_check_winner_loop(void *context, long iterations) {
+    const BoardBatch *batch = (const BoardBatch *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        for (int b = 0; b < BATCH_BOARDS; b++) {
+            total += board_check_winner(&batch->boards[b], PLAYER1) ? PLAYER1 :
+                     (board_check_winner(&batch->boards[b], PLAYER2) ? PLAYER2 : EMPTY);
+        }
+    }
+    sink = total;
+}
+
+static void bench_check_winner_batch(void *context, long iterations) {
+    BoardBatch *batch = (BoardBatch *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        board_check_winner_batch(batch->boards, BATCH_BOARDS, batch->winners);
+        total += batch->winners[i % BATCH_BOARDS];
+    }
+    sink = total;
+}
+
+static void bench_score_position(void *context, long iterations) {
+    const PositionSet *set = (const PositionSet *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        for (int p = 0; p < BENCH_POSITION_COUNT; p++) {
+            total += score_position(&set->boards[p], set->to_move[p]);
+        }
+    }
+    sink = total;
+}
+
+typedef struct {
+    Board board;
+    int depth;
+} PerftContext;
+
+static void bench_perft(void *context, long iterations) {
+    const PerftContext *perft = (const PerftContext *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        total += (long long)board_perft(&perft->board, PLAYER1, perft->depth);
+    }
+    sink = total;
+}
+
+// Leaf counts and speed for every depth up to `max_depth`
+static void run_perft(int max_depth) {
+    Board board;
+    board_init(&board);
+
+    printf("%-6s %16s %12s %14s\n", "depth", "leaves", "ms", "leaves/s");
+    for (int depth = 1; depth <= max_depth; depth++) {
+        unsigned long long start = now_ns();
+        unsigned long long leaves = board_perft(&board, PLAYER1, depth);
+        unsigned long long elapsed = now_ns() - start;
+
+        printf("%-6d %16llu %12.2f %14.0f\n",
+               depth, leaves, (double)elapsed / 1e6,
+               elapsed > 0 ? (double)leaves * 1e9 / (double)elapsed : 0.0);
+    }
+}
+
+/* AI levels */
+
+static void bench_ai_level(void *context, long iterations) {
+    const PositionSet *set = (const PositionSet *)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        for (int p = 0; p < BENCH_POSITION_COUNT; p++) {
+            total += ai_search(&set->boards[p], set->to_move[p], set->level, NULL);
+        }
+    }
+    sink = total;
+}
+
+/* history */
+
+// A full 42 move game: fill the board column by column
+static void build_history(Move **head) {
+    Board board;
+    CellState player = PLAYER1;
+
+    board_init(&board);
+    for (int col = 0; col < COLS; col++) {
+        for (int r = 0; r < ROWS; r++) {
+            int row = board_drop_piece(&board, col, player);
+            history_add_move(head, row, col, player);
+            player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+        }
+    }
+}
+
+static void bench_history_add_free(void *context, long iterations) {
+    (void)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        Move *head = NULL;
+        build_history(&head);
+        total += (head != NULL);
+        history_free(&head);
+    }
+    sink = total;
+}
+
+static void bench_history_replay(void *context, long iterations) {
+    const Move *head = (const Move *)context;
+    long long total = 0;
+    Board board;
+
+    board_init(&board);
+    for (long i = 0; i < iterations; i++) {
+        history_replay(head, &board);
+        total += board.cells[0][i % COLS];
+    }
+    sink = total;
+}
+
+static void bench_history_undo(void *context, long iterations) {
+    (void)context;
+    long long total = 0;
+
+    for (long i = 0; i < iterations; i++) {
+        Move *head = NULL;
+        Board board;
+        CellState player;
+
+        build_history(&head);
+        board_init(&board);
+        history_replay(head, &board);
+        while (history_undo(&board, &head, &player)) {
+            total += player;
+        }
+    }
+    sink = total;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-r repetitions] [-t target_ms] [-p perft_depth] [filter]\n"
+            "  filter  only run benchmarks whose name contains this string\n"
+            "  -p      print perft leaf counts and speed from the empty board, then exit\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig config = {DEFAULT_REPETITIONS, DEFAULT_TARGET_NS, NULL};
+    PositionSet set;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:t:p:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                run_perft(atoi(optarg));
+                return 0;
+            case 'r':
+                config.repetitions = atoi(optarg);
+                break;
+            case 't':
+                config.target_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        config.filter = argv[optind];
+    }
+    if (config.repetitions < 1) {
+        config.repetitions = 1;
+    }
+
+    for (int p = 0; p < BENCH_POSITION_COUNT; p++) {
+        if (board_play_moves(&set.boards[p], BENCH_POSITIONS[p], &set.to_move[p]) < 0) {
+            fprintf(stderr, "connect4_bench: bad benchmark position \"%s\"\n", BENCH_POSITIONS[p]);
+            return 1;
+        }
+    }
+
+    // ai_easy draws from the thread's generator, keep its sequence identical between runs
+    rng_seed(rng_thread(), 1);
+
+    printf("%-28s %12s %12s %12s %12s\n", "benchmark", "min ns/op", "median", "p99", "ops/rep");
+
+    run_benchmark(&config, "board_drop_piece", bench_drop_piece, &set, BENCH_POSITION_COUNT);
+    run_benchmark(&config, "board_check_winner", bench_check_winner, &set, BENCH_POSITION_COUNT);
+    run_benchmark(&config, "score_position", bench_score_position, &set, BENCH_POSITION_COUNT);
+
+    // reported per board, both players checked
+    BoardBatch *batch = (BoardBatch *)malloc(sizeof(BoardBatch));
+    if (batch == NULL) {
+        fprintf(stderr, "connect4_bench: out of memory\n");
+        return 1;
+    }
+    build_batch(batch);
+    run_benchmark(&config, "check_winner_loop", bench_check_winner_loop, batch, BATCH_BOARDS);
+    static const char *BATCH_KERNEL_NAMES[] = {"scalar", "sse2", "avx2"};
+    const char *default_kernel = board_batch_kernel();
+    for (int k = 0; k < 3; k++) {
+        char name[64];
+        if (!board_batch_select(BATCH_KERNEL_NAMES[k])) {
+            continue;
+        }
+        snprintf(name, sizeof(name), "check_winner_batch_%s", BATCH_KERNEL_NAMES[k]);
+        run_benchmark(&config, name, bench_check_winner_batch, batch, BATCH_BOARDS);
+    }
+    board_batch_select(default_kernel);
+    free(batch);
+
+    // reported per leaf
+    PerftContext perft;
+    board_init(&perft.board);
+    perft.depth = 5;
+    run_benchmark(&config, "board_perft_5", bench_perft, &perft,
+                  (long)board_perft(&perft.board, PLAYER1, perft.depth));
+
+    static const char *LEVEL_NAMES[] = {"ai_easy", "ai_medium", "ai_hard", "ai_expert"};
+    for (int level = AI_EASY; level <= AI_EXPERT; level++) {
+        set.level = (AILevel)level;
+        run_benchmark(&config, LEVEL_NAMES[level], bench_ai_level, &set, BENCH_POSITION_COUNT);
+    }
+
+    Move *game = NULL;
+    build_history(&game);
+    run_benchmark(&config, "history_add_free_42", bench_history_add_free, NULL, 1);
+    run_benchmark(&config, "history_replay_42", bench_history_replay, game, 1);
+    run_benchmark(&config, "history_build_undo_42", bench_history_undo, NULL, 1);
+    history_free(&game);
+
+    return 0;
+}
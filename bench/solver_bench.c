@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "ai.h"
+#include "solver.h"
+
+// Solves the reference position sets in tests/data with the exact solver,
+// checks every score and reports mean time and nodes per position. With a
+// baseline file the run fails when a set's mean solve time, or with -g nodes
+// its mean node count, grew by more than the allowed ratio. Node counts do not
+// depend on the machine, so only they make a gate that ctest can always run.
+//
+// Set files hold one position per line: "<moves> <score>", moves as 1-based
+// column digits, score from the point of view of the player to move.
+
+#define SOLVER_BENCH_TT_LOG2 23
+#define MAX_LINE 256
+#define MAX_BASELINES 32
+
+static const char *DEFAULT_SETS[] = {
+    "end_easy", "middle_easy", "middle_medium", "begin_easy", "begin_medium", "begin_hard"
+};
+
+typedef struct {
+    char name[64];
+    double mean_us;
+    double mean_nodes;      // 0 in baselines written before node counts were kept
+} Baseline;
+
+typedef struct {
+    int positions;
+    int errors;
+    double total_us;
+    unsigned long long total_nodes;
+    unsigned long long total_collisions;
+    unsigned long long total_overwrites;
+} SetResult;
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// "<name> <mean_us> [<mean_nodes>]" per line, '#' starts a comment
+static int load_baselines(const char *path, Baseline *baselines) {
+    char line[MAX_LINE];
+    int count = 0;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    while (count < MAX_BASELINES && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') {
+            continue;
+        }
+        baselines[count].mean_nodes = 0.0;
+        if (sscanf(line, "%63s %lf %lf", baselines[count].name, &baselines[count].mean_us,
+                   &baselines[count].mean_nodes) >= 2) {
+            count = count + 1;
+        }
+    }
+
+    fclose(file);
+    return count;
+}
+
+static const Baseline *find_baseline(const Baseline *baselines, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(baselines[i].name, name) == 0) {
+            return &baselines[i];
+        }
+    }
+    return NULL;
+}
+
+static int run_set(Solver *solver, const char *path, SetResult *result) {
+    char line[MAX_LINE];
+    int line_number = 0;
+    FILE *file = fopen(path, "r");
+
+    memset(result, 0, sizeof(*result));
+    if (file == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        char moves[128];
+        int expected;
+        Board board;
+        CellState to_move;
+        Position position;
+        SearchStats stats = {0};
+        int score;
+
+        line_number = line_number + 1;
+        if (line[0] == '#' || sscanf(line, "%127s %d", moves, &expected) != 2) {
+            continue;
+        }
+
+        if (board_play_moves(&board, moves, &to_move) < 0) {
+            fprintf(stderr, "%s:%d: invalid position %s\n", path, line_number, moves);
+            result->errors = result->errors + 1;
+            continue;
+        }
+
+        // every position starts from an empty table, as in the reference runs
+        solver_reset(solver);
+        solver->stats = &stats;
+        solver_position_from_board(&position, &board, to_move);
+
+        unsigned long long start = now_ns();
+        solver_solve(solver, &position, &score);
+        unsigned long long elapsed = now_ns() - start;
+
+        if (score != expected) {
+            fprintf(stderr, "%s:%d: %s scored %d, expected %d\n", path, line_number, moves, score, expected);
+            result->errors = result->errors + 1;
+        }
+
+        result->positions = result->positions + 1;
+        result->total_us = result->total_us + (double)elapsed / 1000.0;
+        result->total_nodes = result->total_nodes + stats.nodes;
+        result->total_collisions = result->total_collisions + stats.tt_collisions;
+        result->total_overwrites = result->total_overwrites + stats.tt_overwrites;
+    }
+
+    fclose(file);
+    solver->stats = NULL;
+    return 1;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-d data_dir] [-t tt_log2] [-r always|depth|two-tier] [-b baseline] [-g time|nodes]\n"
+            "          [-x max_ratio] [-w new_baseline] [set...]\n"
+            "  set     name of <data_dir>/<set>.txt (default: all six reference sets)\n"
+            "  -t      transposition table of about 2^tt_log2 entries, 18..28 (default 23)\n"
+            "  -r      table replacement scheme (default two-tier)\n"
+            "  -b      fail when a set's mean exceeds its baseline by more than max_ratio\n"
+            "  -g      what -b compares: time (default) or nodes, which is the same on every machine\n"
+            "  -x      allowed ratio of the mean over the baseline (default 1.25)\n"
+            "  -w      write this run's mean times and node counts as a new baseline file\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *data_dir = "data";
+    const char *baseline_path = NULL;
+    const char *write_path = NULL;
+    double max_ratio = 1.25;
+    int gate_nodes = 0;
+    Baseline baselines[MAX_BASELINES];
+    int baseline_count = 0;
+    int tt_log2 = SOLVER_BENCH_TT_LOG2;
+    TableReplacement replacement = TABLE_TWO_TIER;
+    int failed = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:t:r:b:g:x:w:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 't':
+                tt_log2 = atoi(optarg);
+                break;
+            case 'r':
+                if (!solver_parse_replacement(optarg, &replacement)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'b':
+                baseline_path = optarg;
+                break;
+            case 'g':
+                if (strcmp(optarg, "time") != 0 && strcmp(optarg, "nodes") != 0) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                gate_nodes = (strcmp(optarg, "nodes") == 0);
+                break;
+            case 'x':
+                max_ratio = atof(optarg);
+                break;
+            case 'w':
+                write_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    const char **sets = DEFAULT_SETS;
+    int set_count = (int)(sizeof(DEFAULT_SETS) / sizeof(DEFAULT_SETS[0]));
+    if (optind < argc) {
+        sets = (const char **)&argv[optind];
+        set_count = argc - optind;
+    }
+
+    if (baseline_path != NULL) {
+        baseline_count = load_baselines(baseline_path, baselines);
+        if (baseline_count < 0) {
+            fprintf(stderr, "connect4_solver_bench: cannot read baseline %s\n", baseline_path);
+            return 1;
+        }
+    }
+
+    FILE *baseline_out = NULL;
+    if (write_path != NULL) {
+        baseline_out = fopen(write_path, "w");
+        if (baseline_out == NULL) {
+            perror(write_path);
+            return 1;
+        }
+        fprintf(baseline_out, "# set mean_us mean_nodes\n");
+    }
+
+    TranspositionTable table;
+    Solver solver;
+    if (!solver_table_init(&table, tt_log2, replacement)) {
+        fprintf(stderr, "connect4_solver_bench: out of memory\n");
+        return 1;
+    }
+    solver_init_shared(&solver, &table);
+
+    printf("%-16s %9s %7s %14s %14s %12s %12s %12s %s\n",
+           "set", "positions", "errors", "mean us", "mean nodes", "knodes/s",
+           "collisions", "overwrites", "baseline");
+
+    for (int i = 0; i < set_count; i++) {
+        char path[512];
+        SetResult result;
+
+        snprintf(path, sizeof(path), "%s/%s.txt", data_dir, sets[i]);
+        if (!run_set(&solver, path, &result) || result.positions == 0) {
+            fprintf(stderr, "connect4_solver_bench: no positions in %s\n", path);
+            failed = 1;
+            continue;
+        }
+
+        double mean_us = result.total_us / result.positions;
+        double mean_nodes = (double)result.total_nodes / result.positions;
+        double knps = result.total_us > 0 ? (double)result.total_nodes / result.total_us * 1000.0 : 0.0;
+
+        printf("%-16s %9d %7d %14.1f %14.0f %12.0f %12.0f %12.0f ",
+               sets[i], result.positions, result.errors, mean_us, mean_nodes, knps,
+               (double)result.total_collisions / result.positions,
+               (double)result.total_overwrites / result.positions);
+
+        const Baseline *baseline = find_baseline(baselines, baseline_count, sets[i]);
+        if (baseline != NULL && (!gate_nodes || baseline->mean_nodes > 0.0)) {
+            double ratio = gate_nodes ? mean_nodes / baseline->mean_nodes : mean_us / baseline->mean_us;
+            int regressed = ratio > max_ratio;
+            printf("%.2fx%s\n", ratio, regressed ? " REGRESSION" : "");
+            if (regressed) {
+                failed = 1;
+            }
+        } else {
+            printf("-\n");
+        }
+
+        if (result.errors > 0) {
+            failed = 1;
+        }
+        if (baseline_out != NULL) {
+            fprintf(baseline_out, "%s %.1f %.0f\n", sets[i], mean_us, mean_nodes);
+        }
+    }
+
+    if (baseline_out != NULL) {
+        fclose(baseline_out);
+    }
+    solver_table_free(&table);
+    return failed;
+}
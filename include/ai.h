@@ -1,25 +1,102 @@
 #ifndef AI_H
 #define AI_H
 #include "board.h"
+#include "tablebase.h"
+#include "rng.h"
 #include <stdlib.h>
+#include <stdio.h>
 #include <pthread.h>
+#include <stdatomic.h>
 
 typedef enum {
     AI_EASY,
     AI_MEDIUM,
     AI_HARD,
-    AI_EXPERT
+    AI_EXPERT,
+    AI_PERFECT,
+    AI_MCTS
 } AILevel;
 
+// Counters filled by every search. Levels without a transposition table or
+// alpha-beta pruning leave the tt_* and beta_cutoffs fields at zero.
+typedef struct {
+    unsigned long long nodes;             // positions generated
+    unsigned long long leaf_evaluations;  // heuristic evaluations
+    unsigned long long tt_probes;
+    unsigned long long tt_hits;
+    unsigned long long tt_stores;
+    unsigned long long tt_collisions;     // probes that found another position in the slot
+    unsigned long long tt_overwrites;     // stores that evicted another position
+    unsigned long long beta_cutoffs;
+    unsigned long long tablebase_hits;    // positions answered by the endgame tablebase
+    int max_depth;                        // deepest ply reached
+    unsigned long long elapsed_ns;
+    double nodes_per_second;
+} SearchStats;
+
+// Principal variation: the line a search expects, starting with its own move
+typedef struct {
+    int length;
+    int moves[MAX_CELLS];   // 0-based columns
+} SearchLine;
+
+typedef struct {
+    int column;
+    SearchStats stats;
+    SearchLine pv;          // at least the chosen column, longer where the search has one
+} SearchResult;
+
+// One update per completed depth of a search. The score is from the AI's point
+// of view: the solver score for an exact result, the heuristic evaluation for a
+// depth of iterative deepening, and for mcts the expected result in per mille
+// (-1000 loss, 1000 win).
+typedef struct {
+    int depth;
+    int column;
+    int score;
+    const SearchStats *stats;   // counters so far
+    const SearchLine *pv;       // line behind the score, NULL if the search has none
+} SearchProgress;
+
+typedef void (*SearchProgressFn)(const SearchProgress *progress, void *user);
+
+// Lets another thread stop a search, bounds it in time and reports on it as it
+// goes. A stopped search still returns a legal move: the best of the last
+// completed depth, or a quick one if there is none.
+typedef struct {
+    atomic_int stop;                  // raised by ai_context_stop
+    unsigned long long deadline_ns;   // CLOCK_MONOTONIC, 0 = none
+    SearchProgressFn progress;        // may be NULL
+    void *user;                       // passed to progress
+    Rng *rng;                         // random moves, NULL = the calling thread's generator
+} SearchContext;
+
 typedef struct {
     Board board_copy;
     CellState ai_player;
     AILevel ai_level;
+    SearchContext *context;     // may be NULL
     int result;
+    SearchStats stats;
 } AIThread;
 
+// Search on the opponent's time. While the opponent thinks, a background thread
+// works on the positions it can reach: the perfect level solves every reply,
+// the mcts level grows its tree from the opponent's position. The next
+// ai_search for the AI uses what was found and cancels nothing if the
+// opponent played something else.
+typedef struct {
+    pthread_t thread;
+    int running;
+    atomic_int stop;
+    Board board;            // position the opponent moves from
+    CellState ai_player;
+    AILevel level;
+} Ponder;
+
 /**
  * @brief Easy level AI: Chooses a random valid move, still smart, but does not have advanced strategies. It can lose, but it does the bare minimum (blocks and plays a valid move)
+ *        Draws from the calling thread's generator (rng_thread); seed a SearchContext for other sequences
  * @return Column index (0-based)
  */
 int ai_easy(const Board *board, CellState ai_player);
@@ -47,6 +124,98 @@ int ai_hard(const Board *board, CellState ai_player);
  * @return Column index (0-based)
  */
 int ai_expert(const Board *board, CellState ai_player);
+
+/**
+ * @brief Perfect level AI: plays the exact solver's best move whenever the position can be solved
+ *        within a fixed node budget, and searches the heuristic with iterative deepening otherwise
+ *        (early game, other board sizes).
+ * @return Column index (0-based)
+ */
+int ai_perfect(const Board *board, CellState ai_player);
+
+/**
+ * @brief MCTS level AI: Monte Carlo tree search with random playouts (see mcts.h). Works on every
+ *        board size, plays stronger with more playouts, and keeps its tree from one move to the next.
+ * @return Column index (0-based)
+ */
+int ai_mcts(const Board *board, CellState ai_player);
+
+/**
+ * @brief Pick a move with the given difficulty level and record what the search did
+ * @param result Output (may be NULL): chosen column and search statistics
+ * @return Column index (0-based)
+ */
+int ai_search(const Board *board, CellState ai_player, AILevel level, SearchResult *result);
+
+/**
+ * @brief Prepare a context with no deadline, no progress callback and the thread's generator
+ */
+void ai_context_init(SearchContext *context);
+
+/**
+ * @brief Give searches under `context` `time_limit_ns` from now (0 removes the deadline)
+ */
+void ai_context_set_time_limit(SearchContext *context, unsigned long long time_limit_ns);
+
+/**
+ * @brief Take the time limit from CONNECT4_AI_TIME_MS (milliseconds per move), if it is set
+ */
+void ai_context_from_env(SearchContext *context);
+
+/**
+ * @brief Ask the searches under `context` to return as soon as they can; safe from any thread
+ */
+void ai_context_stop(SearchContext *context);
+
+/**
+ * @brief 1 once the context was stopped or its deadline has passed
+ */
+int ai_context_expired(const SearchContext *context);
+
+/**
+ * @brief ai_search under a context: the perfect and mcts levels can be stopped, honour the
+ *        deadline and report progress; the other levels are too fast to need it
+ * @param context May be NULL, which is the same as ai_search
+ * @return Column index (0-based)
+ */
+int ai_search_context(const Board *board, CellState ai_player, AILevel level,
+                      SearchContext *context, SearchResult *result);
+
+/**
+ * @brief Prepare a ponder that is not running
+ */
+void ai_ponder_init(Ponder *ponder);
+
+/**
+ * @brief Start pondering on `board`, where the opponent of `ai_player` is to move. Any earlier
+ *        ponder is stopped first. Only the perfect and mcts levels ponder, and CONNECT4_PONDER=0
+ *        turns it off.
+ * @return 1 if a background search was started, 0 otherwise
+ */
+int ai_ponder_start(Ponder *ponder, const Board *board, CellState ai_player, AILevel level);
+
+/**
+ * @brief Wait for the background search to run out of work
+ */
+void ai_ponder_wait(Ponder *ponder);
+
+/**
+ * @brief Cancel the background search and wait for it; call before the AI moves
+ */
+void ai_ponder_stop(Ponder *ponder);
+
+/**
+ * @brief Endgame tablebase the perfect level probes, NULL for none. Without a call the
+ *        table in the file named by CONNECT4_TABLEBASE is loaded on first use. Not while a
+ *        search runs; the table must outlive every search that uses it
+ */
+void ai_set_tablebase(const Tablebase *tablebase);
+
+/**
+ * @brief Print search statistics as a single key=value line
+ */
+void ai_print_stats(FILE *out, const SearchStats *stats);
+
 /**
  * @brief The famous thread function that runs all the AI computations in parallel
  */
@@ -0,0 +1,80 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "history.h"
+
+/*
+ * Binary game archive.
+ *
+ * File layout (all integers little-endian):
+ *   header: "C4AR", version (u8), rows (u8), cols (u8), connect (u8)
+ *   record: move count (u8), then one byte per move: (player << 4) | col
+ *
+ * Rows are not stored, they are recovered by replaying the columns. Every
+ * game in a file has the header's geometry; a connect byte of 0 (archives
+ * written before variants existed) means 4.
+ * The sidecar "<archive>.idx" holds the byte offset of every record so
+ * a game can be found without walking the file.
+ */
+
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_HEADER_SIZE 8
+
+typedef struct {
+    const unsigned char *data;  // mmapped archive contents
+    size_t size;
+    uint64_t *offsets;          // record offset for every game
+    size_t game_count;
+    BoardConfig config;         // geometry from the header
+} GameArchive;
+
+/**
+ * @brief Append one finished game played on `config` to the archive, creating the file if needed
+ * @return 1 on success, 0 on failure or if the file holds games of another geometry
+ */
+int archive_append_game(const char *filename, const BoardConfig *config, const Move *head);
+
+/**
+ * @brief Map an archive into memory and load (or rebuild) its offset index
+ * @return 1 on success, 0 on failure
+ */
+int archive_open(GameArchive *archive, const char *filename);
+
+/**
+ * @brief Unmap the archive and free the index
+ */
+void archive_close(GameArchive *archive);
+
+/**
+ * @brief Number of games stored in an opened archive
+ */
+size_t archive_game_count(const GameArchive *archive);
+
+/**
+ * @brief Number of moves in game `index`
+ * @return Move count, or -1 if index is out of range
+ */
+int archive_game_length(const GameArchive *archive, size_t index);
+
+/**
+ * @brief Rebuild the final position of game `index` (same semantics as history_replay)
+ * @return 1 on success, 0 if index is out of range or the record is corrupt
+ */
+int archive_replay(const GameArchive *archive, size_t index, Board *board);
+
+/**
+ * @brief Load game `index` as a history list (rows are recomputed)
+ * @return 1 on success, 0 on failure. The caller frees the list with history_free.
+ */
+int archive_load_moves(const GameArchive *archive, size_t index, Move **head);
+
+/**
+ * @brief Write the offset index of an opened archive to `filename`
+ * @return 1 on success, 0 on failure
+ */
+int archive_write_index(const GameArchive *archive, const char *filename);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Bump allocator over a chain of blocks. Allocations are never freed one by
+ * one: a search or a game takes a mark, allocates freely and rewinds to the
+ * mark when it is done, or the owner resets the whole arena. Blocks are kept
+ * for reuse, so a warmed-up arena does not call malloc again.
+ *
+ * An arena is not thread safe; every thread has its own (arena_thread), which
+ * keeps worker threads from contending for the malloc lock.
+ */
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t size;        // usable bytes after the header
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *current;    // blocks after it are empty
+    size_t block_size;
+} Arena;
+
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+/**
+ * @brief Initialize an empty arena; blocks of `block_size` bytes are allocated on demand
+ */
+void arena_init(Arena *arena, size_t block_size);
+
+/**
+ * @brief Free every block
+ */
+void arena_free(Arena *arena);
+
+/**
+ * @brief Allocate `size` bytes aligned to ARENA_ALIGNMENT; larger requests get a block of their own
+ * @return The memory, or NULL if out of memory
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Current position, to be passed to arena_rewind
+ */
+ArenaMark arena_mark(const Arena *arena);
+
+/**
+ * @brief Release everything allocated since `mark`
+ */
+void arena_rewind(Arena *arena, ArenaMark mark);
+
+/**
+ * @brief Release every allocation, keeping the blocks
+ */
+void arena_reset(Arena *arena);
+
+/**
+ * @brief Bytes held in blocks, used or not
+ */
+size_t arena_capacity(const Arena *arena);
+
+/**
+ * @brief Arena of the calling thread, created on first use and freed when the thread exits
+ * @return The arena, or NULL if out of memory
+ */
+Arena *arena_thread(void);
+
+#endif
@@ -1,8 +1,18 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include <stdint.h>
+
+// Standard geometry: 7 columns, 6 rows, four in a row wins
 #define ROWS 6
 #define COLS 7
+#define CONNECT 4
+
+// Largest geometry selectable at runtime; move strings limit columns to 9
+// and the bitboards to 64 cells
+#define MAX_ROWS 8
+#define MAX_COLS 9
+#define MAX_CELLS 64
 
 typedef enum {
     EMPTY,
@@ -11,20 +21,110 @@ typedef enum {
 } CellState;
 
 typedef struct {
-    CellState cells[ROWS][COLS];
-} Board;
+    int rows;
+    int cols;
+    int connect;    // Stones in a row needed to win
+} BoardConfig;
+
+// One bit per cell, column by column from the bottom up: the cell `height`
+// stones above the bottom of `col` is bit (col * rows + height).
+typedef uint64_t Bitboard;
+
+typedef struct Board Board;
+
+// Bitboard routines of one geometry, picked from a table by board_init_config.
+// The common sizes are compiled with their shifts and masks as constants;
+// `board` only supplies the geometry to the generic fallback.
+typedef struct {
+    // 1 if `stones` hold `connect` in a row
+    int (*has_line)(const Board *board, Bitboard stones);
+    // Every cell that would complete a line of `stones`, occupied or not
+    Bitboard (*threats)(const Board *board, Bitboard stones);
+    // The lowest empty cell of every column that is not full
+    Bitboard (*playable)(const Board *board, Bitboard occupied);
+    // Number of windows of `connect` cells holding exactly connect, connect - 1
+    // and connect - 2 of `stones`, in counts[0..2]
+    void (*window_counts)(const Board *board, Bitboard stones, int counts[3]);
+} BoardKernel;
+
+struct Board {
+    // CellState values, one byte each so an 8x8 board copies faster than the old
+    // 7x6 one of ints. Only rows x cols are used, row 0 is the top.
+    unsigned char cells[MAX_ROWS][MAX_COLS];
+    int rows;
+    int cols;
+    int connect;
+    const BoardKernel *kernel;
+    Bitboard stones[2];     // PLAYER1 and PLAYER2 pieces, kept in step with cells
+};
+
+extern const BoardConfig BOARD_STANDARD;
 
 /**
- * @brief Initialize an empty board
+ * @brief Initialize an empty standard 7x6 board
  */
 void board_init(Board *board);
 
+/**
+ * @brief Initialize an empty board of any valid geometry
+ * @return 1 on success, 0 if the geometry is invalid (the board is then standard)
+ */
+int board_init_config(Board *board, const BoardConfig *config);
+
+/**
+ * @brief Remove every piece, keeping the geometry
+ */
+void board_clear(Board *board);
+
+/**
+ * @brief Geometry of an initialized board
+ */
+BoardConfig board_config(const Board *board);
+
+/**
+ * @brief Check a geometry: 4..MAX_ROWS rows, 4..MAX_COLS columns, at most MAX_CELLS cells,
+ *        4 <= connect <= min(rows, cols)
+ * @return 1 if valid, 0 otherwise
+ */
+int board_config_valid(const BoardConfig *config);
+
+/**
+ * @brief Parse "<cols>x<rows>" or "<cols>x<rows>:<connect>" (e.g. "9x6:5"), connect defaults to 4
+ * @return 1 on success, 0 if the text is malformed or the geometry is invalid
+ */
+int board_config_parse(const char *text, BoardConfig *config);
+
 /**
  * @brief Drop a piece in the specified column
  * @return Row where piece was placed, or -1 if column is full/invalid
  */
 int board_drop_piece(Board *board, int col, CellState player);
 
+/**
+ * @brief Put `state` (EMPTY to remove a piece) into a cell directly, gravity is not applied
+ */
+void board_set_cell(Board *board, int row, int col, CellState state);
+
+/**
+ * @brief Bit of the cell at (row, col), row 0 being the top as in `cells`
+ */
+Bitboard board_cell_bit(const Board *board, int row, int col);
+
+/**
+ * @brief Bits of every cell of a column
+ */
+Bitboard board_column_cells(const Board *board, int col);
+
+/**
+ * @brief Empty cells where a piece of `player` would complete a line, playable now or not
+ */
+Bitboard board_winning_cells(const Board *board, CellState player);
+
+/**
+ * @brief Cells a piece dropped right now would land on, one per column that is not full
+ */
+Bitboard board_playable_cells(const Board *board);
+
 /**
  * @brief Check if a move is valid
  * @return 1 if valid, 0 otherwise
@@ -48,10 +148,55 @@ void board_print(const Board *board);
  */
 int board_check_winner(const Board *board, CellState player);
 
+/**
+ * @brief Check many boards at once: out[i] is the player with a line on boards[i]
+ *        (PLAYER1 if both have one), EMPTY if neither has. Boards of one geometry
+ *        are checked several per instruction, see board_batch_kernel
+ */
+void board_check_winner_batch(const Board *boards, int count, CellState *out);
+
+/**
+ * @brief out[i] = 1 if stones[i] hold a line on the geometry of `board`, 0 otherwise
+ */
+void board_has_line_batch(const Board *board, const Bitboard *stones, int count, unsigned char *out);
+
+/**
+ * @brief Vector unit the batch checks use: "avx2", "sse2" or "scalar", the widest the CPU has
+ */
+const char *board_batch_kernel(void);
+
+/**
+ * @brief Use another batch kernel (for tests and benchmarks), not while batches run
+ * @return 1 on success, 0 if the name is unknown or the CPU lacks it
+ */
+int board_batch_select(const char *name);
+
 /**
  * @brief Check if the game is a draw (board full with no winner)
  * @return 1 if draw, 0 otherwise
  */
 int board_check_draw(const Board *board);
 
+/**
+ * @brief Set up a position from a move string of 1-based column digits (e.g. "4453"),
+ *        starting from an empty standard board with PLAYER1 to move
+ * @param next_player Output (may be NULL): the player to move after the sequence
+ * @return Number of moves played, or -1 if the string is invalid, a column overflows,
+ *         or a move is played after the game was already won
+ */
+int board_play_moves(Board *board, const char *moves, CellState *next_player);
+
+/**
+ * @brief Like board_play_moves, on an empty board of the given geometry
+ */
+int board_play_moves_config(Board *board, const BoardConfig *config, const char *moves,
+                            CellState *next_player);
+
+/**
+ * @brief Count the leaves of the game tree `depth` plies deep from `board` with `player` to move.
+ *        A move that wins (or a full board) ends its line and counts as one leaf.
+ * @return Number of leaf positions
+ */
+unsigned long long board_perft(const Board *board, CellState player, int depth);
+
 #endif
\ No newline at end of file
@@ -20,6 +20,8 @@ typedef struct {
     int is_over;
     CellState winner;
     int is_draw;  
+    Ponder ponder;              // AI search while the human thinks (PVAI)
+    Rng rng;                    // the AI's random moves, RNG_DEFAULT_SEED unless game_seed is called
 } Game;
 
 /**
@@ -31,6 +33,18 @@ typedef struct {
  */
 void game_init(Game *game, GameMode mode, CellState starting_player, CellState ai_player, AILevel ai_level);
 
+/**
+ * @brief Initialize a new game on a board of the given geometry (see board_config_parse)
+ * @return 1 on success, 0 if the geometry is invalid (the game then uses the standard board)
+ */
+int game_init_config(Game *game, const BoardConfig *config, GameMode mode,
+                     CellState starting_player, CellState ai_player, AILevel ai_level);
+
+/**
+ * @brief Restart the AI's random moves from `seed`; the same seed and the same human moves replay a game
+ */
+void game_seed(Game *game, uint64_t seed);
+
 /**
  * @brief Run the main game loop (blocking). Handles:
  *        - human/AI turns
@@ -42,7 +56,7 @@ void game_init(Game *game, GameMode mode, CellState starting_player, CellState a
 void game_run(Game *game);
 
 /**
- * @brief Free any dynamically allocated resources in Game (history list).
+ * @brief Stop pondering and free any dynamically allocated resources in Game (history list).
  */
 void game_cleanup(Game *game);
 
@@ -6,21 +6,97 @@
 
 #define CELL_SIZE 80
 #define BOARD_PADDING 40
-#define WINDOW_WIDTH (COLS * CELL_SIZE + 2 * BOARD_PADDING)
-#define WINDOW_HEIGHT (ROWS * CELL_SIZE + 2 * BOARD_PADDING + 80)
+#define WINDOW_WIDTH(cols) ((cols) * CELL_SIZE + 2 * BOARD_PADDING)
+#define WINDOW_HEIGHT(rows) ((rows) * CELL_SIZE + 2 * BOARD_PADDING + 80)
+#define EVENT_WAIT_TIMEOUT_MS 250   // Longest graphics_handle_events blocks without input
+#define FRAME_INTERVAL_MS 16        // Frame pacing while an animation runs
+#define ANIMATION_STEP_HZ 120       // Fixed rate the animations advance at
+#define FRAME_LOG_SIZE 1024         // Frames kept for the overlay and the CSV dump
+
+// Discs rendered once at init and blitted every frame
+typedef enum {
+    DISC_EMPTY,
+    DISC_PLAYER1,
+    DISC_PLAYER2,
+    DISC_HOVER_PLAYER1,   // Smaller disc above the hovered column
+    DISC_HOVER_PLAYER2,
+    DISC_HIGHLIGHT,       // White disc behind the discs of the winning line
+    DISC_COUNT
+} DiscTexture;
+
+// Disc falling from the top of the board into (row, col)
+typedef struct {
+    int active;
+    int row;
+    int col;
+    CellState player;
+    double progress;           // 0 at the top, 1 once it landed
+    double previous_progress;  // Progress one step earlier, for interpolation
+    double step;               // Progress added per animation step
+} DropAnimation;
+
+// Animation timing, in performance counter ticks
+typedef struct {
+    Uint64 last_update;        // When graphics_update last ran
+    double accumulator;        // Seconds not yet consumed by animation steps
+    double alpha;              // Fraction of a step to interpolate by when drawing
+    Uint64 last_frame;         // When the last frame was presented
+} FrameClock;
+
+typedef struct {
+    Uint64 start;              // Performance counter at the start of the frame
+    Uint32 render_us;          // Drawing
+    Uint32 present_us;         // SDL_RenderPresent, including any vsync wait
+    Uint32 latency_us;         // Click/key to the first frame showing the disc, 0 if none
+} FrameSample;
+
+// Ring buffer of the most recent frames
+typedef struct {
+    FrameSample samples[FRAME_LOG_SIZE];
+    unsigned long count;       // Frames recorded so far, the newest is at (count - 1) % FRAME_LOG_SIZE
+    Uint64 input_time;         // When the move being answered was entered, 0 if none
+    int latency_pending;       // 1 once that move was played, until its frame is presented
+} FrameLog;
 
 typedef struct {
-    SDL_Window *window;
+    SDL_Window *window;   // NULL when rendering offscreen
     SDL_Renderer *renderer;
+    SDL_Surface *surface; // Offscreen render target, NULL when rendering to a window
+    SDL_Texture *discs[DISC_COUNT];
+    int rows;             // Board size the window was made for
+    int cols;
     int running;
     int selected_column;  // Column currently hovered (-1 if none)
+    int dirty;            // 1 if the window needs to be redrawn
+    DropAnimation drop;
+    double highlight;             // Win line highlight opacity, 0..1
+    double previous_highlight;
+    FrameClock clock;
+    FrameLog log;
+    int show_overlay;             // Frame time graph in the status bar, toggled with F1
 } Graphics;
 
 /**
- * @brief Initialize SDL2 and create window/renderer
+ * @brief Initialize SDL2, create window/renderer and pre-render the disc textures
+ * @param config Board geometry the window is sized for, NULL for the standard board
  * @return 0 on success, -1 on failure
  */
-int graphics_init(Graphics *gfx, const char *title);
+int graphics_init(Graphics *gfx, const char *title, const BoardConfig *config);
+
+/**
+ * @brief Initialize SDL2 without a display and render into a software surface
+ *
+ * Uses the dummy video driver, so it works on machines without X or Wayland.
+ * Frames drawn with graphics_render can be saved with graphics_save_snapshot.
+ * @return 0 on success, -1 on failure
+ */
+int graphics_init_offscreen(Graphics *gfx, const BoardConfig *config);
+
+/**
+ * @brief Save the last frame of an offscreen context as a BMP file
+ * @return 0 on success, -1 on failure or for a windowed context
+ */
+int graphics_save_snapshot(Graphics *gfx, const char *path);
 
 /**
  * @brief Clean up SDL2 resources
@@ -35,24 +111,63 @@ void graphics_cleanup(Graphics *gfx);
  * @param game_over Whether the game has ended
  * @param winner The winner (EMPTY if none/draw)
  * @param is_draw 1 if game ended in draw
+ *
+ * Clears gfx->dirty. Call it after anything the frame shows has changed.
  */
 void graphics_render(Graphics *gfx, const Board *board, CellState current_player, 
                      int game_over, CellState winner, int is_draw);
 
 /**
- * @brief Handle SDL events
+ * @brief Start the falling animation of the disc just placed at (row, col)
+ */
+void graphics_animate_drop(Graphics *gfx, int row, int col, CellState player);
+
+/**
+ * @brief Fade in the win line highlight once the last disc has landed
+ */
+void graphics_animate_win(Graphics *gfx);
+
+/**
+ * @brief 1 while an animation is still running
+ */
+int graphics_is_animating(const Graphics *gfx);
+
+/**
+ * @brief Advance the animations to the current time in fixed steps
+ *
+ * Sets gfx->dirty while an animation runs. Call it once per loop iteration.
+ */
+void graphics_update(Graphics *gfx);
+
+/**
+ * @brief Write the frames in the log as CSV: frame, time_ms, render_us, present_us, latency_us
+ * @return 0 on success, -1 on failure
+ */
+int graphics_write_frame_log(const Graphics *gfx, const char *path);
+
+/**
+ * @brief Wake up graphics_handle_events from another thread
+ */
+void graphics_wake(void);
+
+/**
+ * @brief Wait for input, then handle all pending SDL events
+ *
+ * Blocks up to EVENT_WAIT_TIMEOUT_MS, or only until the next frame is due
+ * while an animation runs. Sets gfx->dirty when the hovered column changed
+ * or the window was exposed.
  * @param gfx Graphics context
- * @param col_out Output: column clicked (-1 if none)
+ * @param col_out Output: column clicked (-1 if none); NULL while no move is expected
  * @param quit_out Output: 1 if user wants to quit
- * @param undo_out Output: 1 if user pressed undo
+ * @param undo_out Output: 1 if user pressed undo; may be NULL like col_out
  */
 void graphics_handle_events(Graphics *gfx, int *col_out, int *quit_out, int *undo_out);
 
 /**
  * @brief Convert mouse x position to column index
- * @return Column index (0 to COLS-1), or -1 if outside board
+ * @return Column index (0 to gfx->cols - 1), or -1 if outside board
  */
-int graphics_get_column_from_x(int mouse_x);
+int graphics_get_column_from_x(const Graphics *gfx, int mouse_x);
 
 /**
  * @brief Wait for user to click or press key to continue
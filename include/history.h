@@ -3,6 +3,8 @@
 
 #include "board.h"
 
+// Nodes are owned by the thread that added them: undo and free a list on that
+// thread, and before it exits (see history.c)
 typedef struct Move {
     int row;   
     int col;  
@@ -14,6 +16,7 @@ void history_add_move(Move **head, int row, int col, CellState player);
 
 int history_undo(Board *board, Move **head, CellState *current_player);
 
+// `board` must be initialized; it is cleared and keeps its geometry
 void history_replay(const Move *head, Board *board);
 
 void history_free(Move **head);
@@ -10,13 +10,15 @@ int get_menu_choice(int min, int max);
 
 void clear_screen(void);
 const char *player_name(CellState p);
-int prompt_human_move(int allow_undo);
+int prompt_human_move(int cols, int allow_undo);
 
 #ifdef HAS_GRAPHICS
 /**
  * @brief Run the game with graphics mode
+ * @param seeds Gives every game the seed of its AI's random moves
  */
-void run_graphics_game(GameMode mode, CellState ai_player, AILevel ai_level);
+void run_graphics_game(const BoardConfig *config, GameMode mode, CellState ai_player, AILevel ai_level,
+                       Rng *seeds);
 #endif
 
 #endif
@@ -0,0 +1,125 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "board.h"
+#include "ai.h"
+#include "arena.h"
+#include "rng.h"
+
+/*
+ * Monte Carlo tree search (UCT). Every iteration walks down the tree by the
+ * UCB1 rule, expands one node and finishes the game with random moves on the
+ * bitboard kernels. Each thread grows its own tree of the same position (root
+ * parallelization) and the trees vote with their root visit counts.
+ *
+ * Trees live in fixed node pools, so a search never calls malloc. An engine
+ * keeps its trees between moves: when the next position is a child or
+ * grandchild of the last root, that subtree is compacted to the front of the
+ * pool and its statistics are reused.
+ */
+
+#define MCTS_MAX_THREADS 16
+#define MCTS_NONE UINT32_MAX
+
+typedef struct {
+    int threads;                    // trees searched in parallel, 1..MCTS_MAX_THREADS
+    unsigned long playouts;         // per tree and move
+    unsigned long long time_limit_ns;   // 0 = only the playout budget ends a search
+    uint32_t pool_nodes;            // nodes per tree
+    double exploration;             // UCB1 constant
+    uint64_t seed;                  // first seed of the trees, see mcts_seed
+} MctsConfig;
+
+typedef struct {
+    uint32_t parent;
+    uint32_t first_child;   // children are contiguous, MCTS_NONE until expanded
+    uint32_t visits;
+    uint32_t score;         // half points for the player who moved into the node
+    uint8_t child_count;
+    int8_t column;
+} MctsNode;
+
+typedef struct {
+    MctsNode *nodes;
+    MctsNode *spare;        // compaction target, swapped with `nodes`
+    uint32_t capacity;
+    uint32_t used;
+    uint32_t root;          // MCTS_NONE when the tree is empty
+    Board root_board;
+    CellState root_player;  // player to move at the root
+    Rng rng;
+    // filled by the last search
+    unsigned long long nodes_searched;
+    unsigned long long playouts;
+    int max_depth;
+} MctsTree;
+
+typedef struct {
+    MctsConfig config;
+    MctsTree trees[MCTS_MAX_THREADS];
+    int owns_pools;             // 0 when the pools live in an arena
+    const atomic_int *stop;     // ends a search early once nonzero, may be NULL
+    unsigned long long deadline_ns; // CLOCK_MONOTONIC time to end a search at, 0 = none
+} MctsEngine;
+
+/**
+ * @brief Default settings: 20000 playouts on up to 4 trees, no time limit
+ */
+void mcts_default_config(MctsConfig *config);
+
+/**
+ * @brief Allocate the node pools of an engine
+ * @return 1 on success, 0 on failure
+ */
+int mcts_init(MctsEngine *engine, const MctsConfig *config);
+
+/**
+ * @brief Carve the node pools out of `arena` instead; they last until the arena is rewound
+ * @return 1 on success, 0 on failure
+ */
+int mcts_init_arena(MctsEngine *engine, const MctsConfig *config, Arena *arena);
+
+/**
+ * @brief Free the node pools (nothing to do for pools in an arena)
+ */
+void mcts_free(MctsEngine *engine);
+
+/**
+ * @brief Restart the playouts' random numbers: tree i draws from rng_seed(seed + i)
+ */
+void mcts_seed(MctsEngine *engine, uint64_t seed);
+
+/**
+ * @brief Forget the trees, the next search starts from scratch
+ */
+void mcts_reset(MctsEngine *engine);
+
+/**
+ * @brief Search a position that is not over and return the most visited column
+ * @param stats Output (may be NULL): nodes, playouts (as leaf evaluations) and tree depth, summed over the trees
+ * @return Column index (0-based), or -1 if no column can be played
+ */
+int mcts_best_move(MctsEngine *engine, const Board *board, CellState to_move, SearchStats *stats);
+
+/**
+ * @brief Answer from the trees alone when they already hold at least `min_visits` playouts per
+ *        tree for the position (a pondered or repeated position), without searching
+ * @return Column index (0-based), or -1 if a search is needed
+ */
+int mcts_cached_move(MctsEngine *engine, const Board *board, CellState to_move, unsigned long min_visits);
+
+/**
+ * @brief Expected result of playing `column` at the root of the last search, from -1 (loss)
+ *        to 1 (win) for the player to move, over all trees; 0 if it was never visited
+ */
+double mcts_column_value(const MctsEngine *engine, int column);
+
+/**
+ * @brief Line of the most visited moves after playing `column` at the root, from the first tree
+ * @return Number of columns written to `moves`, `column` included
+ */
+int mcts_principal_variation(const MctsEngine *engine, int column, int *moves, int max_moves);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Pseudo random numbers for the AI (xorshift64*). A generator is one word of
+ * state owned by whoever draws from it: a game, a search context, an MCTS tree
+ * or a thread. Drawing takes no lock, and the same seed always gives the same
+ * numbers, so a seeded game or search plays the same moves again.
+ */
+
+#define RNG_DEFAULT_SEED UINT64_C(0x9e3779b97f4a7c15)
+
+typedef struct {
+    uint64_t state;     // never zero
+} Rng;
+
+/**
+ * @brief Start the generator from `seed`; any value works, neighbouring seeds give unrelated sequences
+ */
+void rng_seed(Rng *rng, uint64_t seed);
+
+/**
+ * @brief Next 64 random bits
+ */
+uint64_t rng_next(Rng *rng);
+
+/**
+ * @brief Uniform number in 0..bound-1, bound > 0
+ */
+uint32_t rng_below(Rng *rng, uint32_t bound);
+
+/**
+ * @brief The calling thread's generator, seeded with RNG_DEFAULT_SEED on first use
+ */
+Rng *rng_thread(void);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "board.h"
+#include "ai.h"
+
+/*
+ * Exact Connect Four solver: negamax with alpha-beta pruning over a bitboard,
+ * a transposition table and a null-window search on the score.
+ *
+ * Scores are from the point of view of the player to move: 0 is a draw,
+ * a positive score means the player to move wins, and it is larger the
+ * earlier the win (22 - k for a win with the player's k-th stone on 7x6).
+ */
+
+#if COLS * (ROWS + 1) > 64
+#error "solver bitboards need COLS * (ROWS + 1) <= 64"
+#endif
+
+#define SOLVER_MIN_SCORE (-(ROWS * COLS) / 2)
+#define SOLVER_MAX_SCORE ((ROWS * COLS + 1) / 2)
+
+// Bitboard position: one bit per cell plus a sentinel row per column.
+typedef struct {
+    uint64_t current;   // stones of the player to move
+    uint64_t mask;      // all stones
+    int moves;          // number of stones played
+} Position;
+
+// Which entry a store may evict. Depth is the number of empty cells, so a deeper
+// entry saved a bigger search; entries of an earlier search can always go.
+typedef enum {
+    TABLE_ALWAYS_REPLACE,   // one entry per slot, the newest wins
+    TABLE_DEPTH_PREFERRED,  // one entry per slot, kept against shallower ones
+    TABLE_TWO_TIER          // two entries per slot: a depth-preferred one and an always-replaced one
+} TableReplacement;
+
+// Every entry is one 64-bit word (key, depth, search, value; see solver.c), read
+// and written with single atomic accesses. Any number of solvers can share a
+// table without locks: a racing store may lose an entry, never corrupt one.
+typedef struct {
+    _Atomic uint64_t *entries;  // `slot_size` entries per slot, 0 = empty
+    uint64_t slots;             // prime number of slots
+    int slot_size;
+    TableReplacement replacement;
+    atomic_uint search;         // bumped by every solve, ages the depth-preferred entries
+} TranspositionTable;
+
+typedef struct {
+    TranspositionTable *table;      // own_table, or one shared with other solvers
+    TranspositionTable own_table;
+    unsigned search;                // number of the running search in the table
+    SearchStats *stats;             // counters of the running search, may be NULL
+    unsigned long long node_limit;  // 0 = unlimited
+    unsigned long long node_count;
+    const atomic_int *stop;         // aborts the search once nonzero, may be NULL
+    unsigned long long deadline_ns; // CLOCK_MONOTONIC time to abort at, 0 = none
+    int aborted;                    // set when node_limit, `stop` or the deadline was hit
+} Solver;
+
+/**
+ * @brief Allocate a table of about 2^tt_log2 entries (18..28), 8 bytes each
+ * @return 1 on success, 0 on failure
+ */
+int solver_table_init(TranspositionTable *table, int tt_log2, TableReplacement replacement);
+
+/**
+ * @brief Free a table allocated with solver_table_init
+ */
+void solver_table_free(TranspositionTable *table);
+
+/**
+ * @brief Read a replacement scheme name: "always", "depth" or "two-tier"
+ * @return 1 on success, 0 if the name is unknown
+ */
+int solver_parse_replacement(const char *text, TableReplacement *replacement);
+
+/**
+ * @brief Allocate a solver with a table of its own of about 2^tt_log2 entries, two-tier replacement
+ * @return 1 on success, 0 on failure
+ */
+int solver_init(Solver *solver, int tt_log2);
+
+/**
+ * @brief Set up a solver on a table that other solvers, in any thread, may use at the same time
+ */
+void solver_init_shared(Solver *solver, TranspositionTable *table);
+
+/**
+ * @brief Free the transposition table if the solver owns it
+ */
+void solver_free(Solver *solver);
+
+/**
+ * @brief Forget all transposition table entries; no other solver may be using the table
+ */
+void solver_reset(Solver *solver);
+
+/**
+ * @brief Check whether the solver handles the board's geometry; it only knows the standard 7x6 board
+ * @return 1 if supported, 0 otherwise
+ */
+int solver_supports(const Board *board);
+
+/**
+ * @brief Convert a board to a bitboard position with `to_move` as the player to move
+ */
+void solver_position_from_board(Position *position, const Board *board, CellState to_move);
+
+/**
+ * @brief Exact score of a position that is not already won or full
+ * @param score Output: the score
+ * @return 1 if solved, 0 if the node limit was reached or the search was stopped first
+ */
+int solver_solve(Solver *solver, const Position *position, int *score);
+
+/**
+ * @brief Best column of a position and its exact score
+ * @param score Output (may be NULL): the score of the best move
+ * @return Column index (0-based), or -1 if the node limit was reached or the search was stopped first
+ */
+int solver_best_move(Solver *solver, const Position *position, int *score);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <stdint.h>
+#include "board.h"
+
+/*
+ * Endgame tablebase: the win/draw/loss value of every position below a root
+ * position with at most `max_empty` empty cells, for any board geometry.
+ *
+ * Every position below the root keeps the root's stones at the bottom of each
+ * column, so it is the root plus a stack of new stones per column. The stacks
+ * are ranked without a hash table: by the number of new stones, then the
+ * stack heights, then which of the new stones (in column order) belong to the
+ * player to move at the root. That ranking is a minimal perfect hash, so the
+ * table stores nothing but 2 bits per position. Mirror images of positions
+ * below the root are found through their mirror.
+ *
+ * The table is solved exhaustively, from the fullest positions up: a position
+ * is lost if the last player to move has a line, drawn if the board is full,
+ * and otherwise the best of its children.
+ *
+ * File layout (all integers little-endian):
+ *   header: "C4TB", version (u8), rows (u8), cols (u8), connect (u8),
+ *           root player to move (u8), max_empty (u8), 2 reserved bytes,
+ *           root stones of PLAYER1 and PLAYER2 (u64 each), positions (u64)
+ *   values: 4 positions per byte, lowest bits first
+ */
+
+#define TABLEBASE_VERSION 1
+#define TABLEBASE_HEADER_SIZE 36
+#define TABLEBASE_MAX_POSITIONS (UINT64_C(1) << 34)  // 4 GB of values
+
+// Value for the player to move, as stored in the 2-bit entries
+typedef enum {
+    TABLEBASE_LOSS,
+    TABLEBASE_DRAW,
+    TABLEBASE_WIN,
+    TABLEBASE_MISSING   // not below the root, or more than max_empty empty cells
+} TablebaseValue;
+
+typedef struct {
+    Board root;                 // geometry and root stones
+    CellState root_to_move;
+    int max_empty;
+    int root_empty;             // empty cells of the root
+    int column_empty[MAX_COLS]; // empty cells of each root column
+    int first_layer;            // fewest new stones a position holds
+    uint64_t positions;
+    uint64_t layer_offset[MAX_CELLS + 2];   // index of the first position with n new stones
+    uint64_t ways[MAX_COLS + 1][MAX_CELLS + 1];  // stack heights of columns c.. that add up to s
+    unsigned char *values;
+} Tablebase;
+
+/**
+ * @brief Solve every position below `root` (player `to_move` to move) with at most `max_empty` empty cells
+ * @return 1 on success, 0 if out of memory or the table would exceed TABLEBASE_MAX_POSITIONS
+ */
+int tablebase_generate(Tablebase *tablebase, const Board *root, CellState to_move, int max_empty);
+
+/**
+ * @brief Number of positions a table would hold, without building it
+ * @return Position count, or 0 if it would exceed TABLEBASE_MAX_POSITIONS
+ */
+uint64_t tablebase_size(const Board *root, int max_empty);
+
+/**
+ * @brief Write a generated table to `filename`
+ * @return 1 on success, 0 on failure
+ */
+int tablebase_save(const Tablebase *tablebase, const char *filename);
+
+/**
+ * @brief Read a table written by tablebase_save
+ * @return 1 on success, 0 if the file is missing, corrupt or of another version
+ */
+int tablebase_load(Tablebase *tablebase, const char *filename);
+
+/**
+ * @brief Free the values of a generated or loaded table
+ */
+void tablebase_free(Tablebase *tablebase);
+
+/**
+ * @brief Value of `board` for `to_move`, or TABLEBASE_MISSING if the table does not hold it
+ */
+TablebaseValue tablebase_probe(const Tablebase *tablebase, const Board *board, CellState to_move);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef THREAT_H
+#define THREAT_H
+
+#include "board.h"
+
+/*
+ * Threat-space analysis. A threat is an empty cell that completes a line for
+ * one player, whether or not it can be played yet.
+ *
+ * Rows are counted from the bottom starting at 1. On a board with an even
+ * number of rows, zugzwang hands the odd rows to the player who moved first
+ * and the even rows to the other one once the board fills up, so only threats
+ * on a player's own parity tend to decide the game. A threat above a lower
+ * threat of the opponent in the same column never comes into play.
+ */
+
+typedef struct {
+    Bitboard all;       // every threat
+    Bitboard odd;       // threats on rows 1, 3, 5, ...
+    Bitboard even;      // threats on rows 2, 4, 6, ...
+    Bitboard playable;  // threats that can be played right now
+    Bitboard live;      // threats not above a lower opponent threat
+} PlayerThreats;
+
+typedef struct {
+    PlayerThreats player[2];    // PLAYER1 and PLAYER2
+    Bitboard odd_rows;          // every cell of the odd rows
+} ThreatMap;
+
+/**
+ * @brief Find and classify the threats of both players
+ */
+void threat_analyze(const Board *board, ThreatMap *map);
+
+/**
+ * @brief Threats of one player
+ */
+const PlayerThreats *threat_player(const ThreatMap *map, CellState player);
+
+/**
+ * @brief Number of cells in a bitboard
+ */
+int threat_count(Bitboard cells);
+
+/**
+ * @brief Player who made the first move, derived from the stone counts and the player to move
+ */
+CellState threat_first_player(const Board *board, CellState to_move);
+
+/**
+ * @brief Check whether `player` wins by force with their next two moves, unless the opponent
+ * wins first: two playable threats, or a playable threat with another one directly above it
+ * @return 1 if so, 0 otherwise
+ */
+int threat_is_double(const Board *board, const ThreatMap *map, CellState player);
+
+/**
+ * @brief Moves of `player` that do not hand the opponent a win with their next stone: the
+ * forced block if the opponent threatens a playable cell, and never the cell under an opponent
+ * threat. Only meaningful when `player` cannot win right away.
+ * @return The cells to play, 0 if every move loses
+ */
+Bitboard threat_non_losing_moves(const Board *board, const ThreatMap *map, CellState player);
+
+/**
+ * @brief Heuristic worth of the live threats of `player`; threats on the player's zugzwang
+ * parity count most. Boards with an odd number of rows have no parity bonus.
+ * @return Score, 0 without live threats
+ */
+int threat_score(const Board *board, const ThreatMap *map, CellState player, CellState first_player);
+
+#endif
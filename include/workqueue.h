@@ -0,0 +1,49 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// Bounded blocking FIFO of pointers shared between producer and consumer threads.
+// Producers block while the queue is full, so memory stays flat no matter how
+// far ahead a fast producer could run.
+typedef struct {
+    void **items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} WorkQueue;
+
+/**
+ * @brief Initialize a queue that holds at most `capacity` items
+ * @return 1 on success, 0 on failure
+ */
+int workqueue_init(WorkQueue *queue, size_t capacity);
+
+/**
+ * @brief Free the queue storage (items themselves are not owned by the queue)
+ */
+void workqueue_destroy(WorkQueue *queue);
+
+/**
+ * @brief Add an item, blocking while the queue is full
+ * @return 1 on success, 0 if the queue has been closed
+ */
+int workqueue_push(WorkQueue *queue, void *item);
+
+/**
+ * @brief Remove the oldest item, blocking while the queue is empty
+ * @return The item, or NULL once the queue is closed and drained
+ */
+void *workqueue_pop(WorkQueue *queue);
+
+/**
+ * @brief Mark the queue closed: pushes fail and pops return NULL after draining
+ */
+void workqueue_close(WorkQueue *queue);
+
+#endif
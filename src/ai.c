@@ -1,18 +1,52 @@
 #include "ai.h"
 #include "board.h"
+#include "solver.h"
+#include "threat.h"
+#include "mcts.h"
+#include <pthread.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// bookkeeping for every position a search generates, `ply` is its distance from the root
+static void search_visit(SearchStats *stats, int ply) {
+    if (stats == NULL) {
+        return;
+    }
+    stats->nodes = stats->nodes + 1;
+    if (ply > stats->max_depth) {
+        stats->max_depth = ply;
+    }
+}
+
+static unsigned long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+// the generator of a search: the context's if it has one, else the thread's
+static Rng *search_rng(const SearchContext *context) {
+    return (context != NULL && context->rng != NULL) ? context->rng : rng_thread();
+}
 
-int ai_easy(const Board *board, CellState ai_player) {
-    int column;
 // the easy ai only plays random valid moves it doesnt do anything else
+static int easy_search(const Board *board, Rng *rng) {
+    int column;
     do {
-        column = rand() % COLS;
+        column = (int)rng_below(rng, (uint32_t)board->cols);
     } while (board_is_valid_move(board, column) == 0);
 
     return column;
 }
 
-int ai_medium(const Board *board, CellState ai_player) {
+int ai_easy(const Board *board, CellState ai_player) {
+    (void)ai_player;
+    return easy_search(board, rng_thread());
+}
+
+static int medium_search(const Board *board, CellState ai_player, SearchStats *stats, Rng *rng) {
     CellState opponent;
 // the medium ai blocks the opponent's winning move if it can, otherwise it plays a random valid move (which is what the easy ai does)
 // turn based logic 
@@ -22,125 +56,49 @@ int ai_medium(const Board *board, CellState ai_player) {
         opponent = PLAYER1;
     }
 // check if the ai can win in the next move
-    for (int column = 0; column < COLS; column++) {
+    for (int column = 0; column < board->cols; column++) {
         if (board_is_valid_move(board, column) == 1) {
             Board temporary_board = *board;
             board_drop_piece(&temporary_board, column, ai_player);
+            search_visit(stats, 1);
             if (board_check_winner(&temporary_board, ai_player) == 1) {
                 return column;
             }
         }
     }
 // check if the opponent can win in the next move and block 
-    for (int column = 0; column < COLS; column++) {
+    for (int column = 0; column < board->cols; column++) {
         if (board_is_valid_move(board, column) == 1) {
             Board temporary_board = *board;
             board_drop_piece(&temporary_board, column, opponent);
+            search_visit(stats, 1);
             if (board_check_winner(&temporary_board, opponent) == 1) {
                 return column;
             }
         }
     }
 // if theres no way to win immediately or block the opponent, play a random valid move
-    return ai_easy(board, ai_player);
+    return easy_search(board, rng);
 }
-// heuristic approach, super cool scoring system lol 
+// heuristic approach, super cool scoring system lol
+// score of 3 for every stone in the center column, then for every window of `connect` cells:
+// 1000 for connect stones of the player, 50 for connect - 1 and 10 for connect - 2
+// (4, 3 and 2 in a row on connect 4), whatever the other cells hold
+// the board kernel counts the windows of all four directions with a few shifts and popcounts
 int score_position(const Board *board, int player_id) {
-    int score = 0;
-    int center_column = COLS / 2;
-// score of 3 for the center column
-    for (int row = 0; row < ROWS; row++) {
-        if (board->cells[row][center_column] == player_id) {
-            score = score + 3;
-        }
-    }
-// score of 10 for 2 in a row, 50 for 3 in a row, and 1000 for 4 in a row
-// this is the horizontal scoring (4 next to each other)
-    for (int row = 0; row < ROWS; row++) {
-        for (int column = 0; column <= COLS - 4; column++) {
-            int count = 0;
-            for (int i = 0; i < 4; i++) {
-                if (board->cells[row][column + i] == player_id) {
-                    count = count + 1;
-                }
-            }
-            if (count == 2) {
-                score = score + 10;
-            }
-            if (count == 3) {
-                score = score + 50;
-            }
-            if (count == 4) {
-                score = score + 1000;
-            }
-        }
-    }
-// this is the vertical scoring (4 on top of each other)
-    for (int column = 0; column < COLS; column++) {
-        for (int row = 0; row <= ROWS - 4; row++) {
-            int count = 0;
-            for (int i = 0; i < 4; i++) {
-                if (board->cells[row + i][column] == player_id) {
-                    count = count + 1;
-                }
-            }
-            if (count == 2) {
-                score = score + 10;
-            }
-            if (count == 3) {
-                score = score + 50;
-            }
-            if (count == 4) {
-                score = score + 1000;
-            }
-        }
-    }
-// this is the positive diagonal scoring (top left to bottom right) "\"
-    for (int row = 0; row <= ROWS - 4; row++) {
-        for (int column = 0; column <= COLS - 4; column++) {
-            int count = 0;
-            for (int i = 0; i < 4; i++) {
-                if (board->cells[row + i][column + i] == player_id) {
-                    count = count + 1;
-                }
-            }
-            if (count == 2) {
-                score = score + 10;
-            }
-            if (count == 3) {
-                score = score + 50;
-            }
-            if (count == 4) {
-                score = score + 1000;
-            }
-        }
-    }
-// other way around, this is the negative diagonal scoring (bottom left to top right) "/"
-    for (int row = 3; row < ROWS; row++) {
-        for (int column = 0; column <= COLS - 4; column++) {
-            int count = 0;
-            for (int i = 0; i < 4; i++) {
-                if (board->cells[row - i][column + i] == player_id) {
-                    count = count + 1;
-                }
-            }
-            if (count == 2) {
-                score = score + 10;
-            }
-            if (count == 3) {
-                score = score + 50;
-            }
-            if (count == 4) {
-                score = score + 1000;
-            }
-        }
-    }
+    Bitboard stones = board->stones[player_id - PLAYER1];
+    Bitboard center = (((Bitboard)1 << board->rows) - 1) << ((board->cols / 2) * board->rows);
+    int counts[3];
 
-    return score;
+    board->kernel->window_counts(board, stones, counts);
+    return 3 * __builtin_popcountll(stones & center) + 1000 * counts[0] + 50 * counts[1] + 10 * counts[2];
 }
 // this is whats going to be used for the minimax algorithm
 // first evalutate the board's current state and give it a score
-static int evaluate_board(const Board *board, CellState ai_player) {
+// the threat map adds what score_position cant see: which threats will ever get
+// played once the board fills up (odd/even rows, see threat.h)
+static int evaluate_threats(const Board *board, const ThreatMap *map, CellState ai_player,
+                            CellState to_move, SearchStats *stats) {
     CellState opponent;
     int ai_score;
     int opponent_score;
@@ -151,30 +109,64 @@ static int evaluate_board(const Board *board, CellState ai_player) {
         opponent = PLAYER1;
     }
 
-    ai_score = score_position(board, ai_player);
-    opponent_score = score_position(board, opponent);
+    if (stats != NULL) {
+        stats->leaf_evaluations = stats->leaf_evaluations + 1;
+    }
+
+    CellState first_player = threat_first_player(board, to_move);
+    ai_score = score_position(board, ai_player) + threat_score(board, map, ai_player, first_player);
+    opponent_score = score_position(board, opponent) + threat_score(board, map, opponent, first_player);
 
     return ai_score - opponent_score;
 }
-// counts how many immediate winning moves are available for a player, this will be used for the expert ai
-static int count_immediate_wins(const Board *board, CellState player) {
-    int wins = 0;
 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
-            Board temporary_board = *board;
-            board_drop_piece(&temporary_board, column, player);
-            if (board_check_winner(&temporary_board, player) == 1) {
-                wins = wins + 1;
-            }
+static int evaluate_board(const Board *board, CellState ai_player, CellState to_move, SearchStats *stats) {
+    ThreatMap map;
+    threat_analyze(board, &map);
+    return evaluate_threats(board, &map, ai_player, to_move, stats);
+}
+// move generator for hard and expert: the moves that dont lose right away (see
+// threat_non_losing_moves). when every move loses it still blocks one of the
+// opponent's threats, or plays anything if there is nothing to block
+static Bitboard search_moves(const Board *board, CellState player) {
+    ThreatMap map;
+    threat_analyze(board, &map);
+
+    Bitboard moves = threat_non_losing_moves(board, &map, player);
+    if (moves == 0) {
+        moves = threat_player(&map, player == PLAYER1 ? PLAYER2 : PLAYER1)->playable;
+    }
+    if (moves == 0) {
+        moves = board_playable_cells(board);
+    }
+    return moves;
+}
+
+static int move_in(const Board *board, Bitboard moves, int column) {
+    return (moves & board_column_cells(board, column)) != 0;
+}
+
+// leftmost column of `moves`, -1 if there is none
+static int first_column(const Board *board, Bitboard moves) {
+    for (int column = 0; column < board->cols; column++) {
+        if (move_in(board, moves, column)) {
+            return column;
         }
     }
-    return wins;
+    return -1;
+}
+
+// the column when there is only one move left to play, -1 otherwise
+static int forced_column(const Board *board, Bitboard moves) {
+    if (threat_count(moves) != 1) {
+        return -1;
+    }
+    return first_column(board, moves);
 }
 // the hard ai is going to implement the minimax algorithm that thinks multiple moves ahead
 // for reference, its a minimum risk maximum reward algorithm
 // bit more advanced but can (possibly?) still be beat 
-int ai_hard(const Board *board, CellState ai_player) {
+static int hard_search(const Board *board, CellState ai_player, SearchStats *stats, Rng *rng) {
         CellState opponent;
     if (ai_player == PLAYER1) {
         opponent = PLAYER2;
@@ -183,10 +175,11 @@ int ai_hard(const Board *board, CellState ai_player) {
     }
 
 
-    for (int column = 0; column < COLS; column++) {
+    for (int column = 0; column < board->cols; column++) {
         if (board_is_valid_move(board, column) == 1) {
             Board temp_board = *board;
             board_drop_piece(&temp_board, column, ai_player);
+            search_visit(stats, 1);
             if (board_check_winner(&temp_board, ai_player) == 1) {
                 return column;
             }
@@ -194,25 +187,23 @@ int ai_hard(const Board *board, CellState ai_player) {
     }
 
 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
-            Board temp_board = *board;
-            board_drop_piece(&temp_board, column, opponent);
-            if (board_check_winner(&temp_board, opponent) == 1) {
-                return column;
-            }
-        }
+    // blocking, and not playing under the opponent's threats, is all done by the move generator
+    Bitboard moves = search_moves(board, ai_player);
+    int forced = forced_column(board, moves);
+    if (forced != -1) {
+        return forced;
     }
 
     int best_column = -1;
     int best_score = 0;
     int best_score_set = 0;
 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
+    for (int column = 0; column < board->cols; column++) {
+        if (move_in(board, moves, column)) {
             Board temporary_board = *board;
             board_drop_piece(&temporary_board, column, ai_player);
-            int current_score = evaluate_board(&temporary_board, ai_player);
+            search_visit(stats, 1);
+            int current_score = evaluate_board(&temporary_board, ai_player, opponent, stats);
 
             if (best_score_set == 0 || current_score > best_score) {
                 best_score = current_score;
@@ -223,14 +214,14 @@ int ai_hard(const Board *board, CellState ai_player) {
     }
 
     if (best_column == -1) {
-        return ai_medium(board, ai_player);
+        return medium_search(board, ai_player, stats, rng);
     }
 
     return best_column;
 }
 // the fun one, it has strategy, it never loses, it forces a draw if it cant win
 // it uses traps, thinks ahead, always blocks attacks, keeps track of the player's pieces and predicts their next move to use it as an advantage, etc.
-int ai_expert(const Board *board, CellState ai_player) {
+static int expert_search(const Board *board, CellState ai_player, SearchStats *stats, Rng *rng) {
     CellState opponent;
     int best_column = -1;
     int best_score = 0;
@@ -242,54 +233,61 @@ int ai_expert(const Board *board, CellState ai_player) {
         opponent = PLAYER1;
     }
     
-    for (int column = 0; column < COLS; column++) {
+    for (int column = 0; column < board->cols; column++) {
         if (board_is_valid_move(board, column) == 1) {
             Board temporary_board = *board;
             board_drop_piece(&temporary_board, column, ai_player);
+            search_visit(stats, 1);
             if (board_check_winner(&temporary_board, ai_player) == 1) {
                 return column;
             }
         }
     }
 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
-            Board temporary_board = *board;
-            board_drop_piece(&temporary_board, column, opponent);
-            if (board_check_winner(&temporary_board, opponent) == 1) {
-                return column;
-            }
-        }
+    Bitboard moves = search_moves(board, ai_player);
+    int forced = forced_column(board, moves);
+    if (forced != -1) {
+        return forced;
     }
     // minimax! evaluating all the potential worst case scenarios and choosing the best worst case
-    // also it checks for immediate winning traps using the function made earlier 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
+    // also it checks for winning traps: two threats the opponent cant both block,
+    // or one with another right above it, as long as the opponent cant win first
+    for (int column = 0; column < board->cols; column++) {
+        if (move_in(board, moves, column)) {
             Board temporary_board = *board;
+            ThreatMap map;
             board_drop_piece(&temporary_board, column, ai_player);
-            int ai_future_wins = count_immediate_wins(&temporary_board, ai_player);
-            if (ai_future_wins >= 2) {
+            search_visit(stats, 1);
+            threat_analyze(&temporary_board, &map);
+            if (threat_player(&map, opponent)->playable == 0 &&
+                threat_is_double(&temporary_board, &map, ai_player)) {
                 return column;
             }
         }
     }
 
-    for (int column = 0; column < COLS; column++) {
-        if (board_is_valid_move(board, column) == 1) {
+    for (int column = 0; column < board->cols; column++) {
+        if (move_in(board, moves, column)) {
             Board temporary_board = *board;
             board_drop_piece(&temporary_board, column, ai_player);
+            search_visit(stats, 1);
 
             int worst_score_for_ai = 0;
             int worst_score_set = 0;
+            // the opponent wont throw the game either
+            Bitboard opponent_moves = search_moves(&temporary_board, opponent);
             
-            for (int opponent_column = 0; opponent_column < COLS; opponent_column++) {
-                if (board_is_valid_move(&temporary_board, opponent_column) == 1) {
+            for (int opponent_column = 0; opponent_column < board->cols; opponent_column++) {
+                if (move_in(&temporary_board, opponent_moves, opponent_column)) {
                     Board opponent_board = temporary_board;
                     board_drop_piece(&opponent_board, opponent_column, opponent);
-                    int position_score = evaluate_board(&opponent_board, ai_player);
+                    search_visit(stats, 2);
+                    ThreatMap map;
+                    threat_analyze(&opponent_board, &map);
+                    int position_score = evaluate_threats(&opponent_board, &map, ai_player, ai_player, stats);
 // check for opponent traps
-                    int opponent_future_wins = count_immediate_wins(&opponent_board, opponent);
-                    if (opponent_future_wins >= 2) {
+                    if (threat_player(&map, ai_player)->playable == 0 &&
+                        threat_is_double(&opponent_board, &map, opponent)) {
                         position_score = position_score - 100000; // dramatic penalty for allowing the opponent to trap the ai
                     }
 
@@ -301,7 +299,7 @@ int ai_expert(const Board *board, CellState ai_player) {
             }
 
             if (worst_score_set == 0) {
-                worst_score_for_ai = evaluate_board(&temporary_board, ai_player);
+                worst_score_for_ai = evaluate_board(&temporary_board, ai_player, opponent, stats);
             }
 
             if (best_score_set == 0 || worst_score_for_ai > best_score) {
@@ -313,20 +311,759 @@ int ai_expert(const Board *board, CellState ai_player) {
     }
 
     if (best_column == -1) {
-        return ai_medium(board, ai_player);
+        return medium_search(board, ai_player, stats, rng);
     }
 
     return best_column;
 }
 
-void *ai_thread_function(void *arg) {
-    AIThread *task = (AIThread *)arg;
+// endgame tablebase, probed by the deepening search
+static pthread_once_t tablebase_once = PTHREAD_ONCE_INIT;
+static Tablebase env_tablebase;
+static const Tablebase *active_tablebase = NULL;
+
+static void load_env_tablebase(void) {
+    const char *path = getenv("CONNECT4_TABLEBASE");
 
-    if (task->ai_level == AI_HARD) {
-        task->result = ai_hard(&task->board_copy, task->ai_player);
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+    if (tablebase_load(&env_tablebase, path)) {
+        active_tablebase = &env_tablebase;
     } else {
-        task->result = ai_expert(&task->board_copy, task->ai_player);
+        fprintf(stderr, "Cannot read CONNECT4_TABLEBASE %s\n", path);
     }
+}
+
+static const Tablebase *current_tablebase(void) {
+    pthread_once(&tablebase_once, load_env_tablebase);
+    return active_tablebase;
+}
+
+void ai_set_tablebase(const Tablebase *tablebase) {
+    pthread_once(&tablebase_once, load_env_tablebase);
+    active_tablebase = tablebase;
+}
+
+// iterative deepening: negamax with alpha-beta over the evaluation, one ply
+// deeper each round until the budget runs out. the perfect level uses it where
+// the solver gives up. the move of the last finished depth is played
+#define DEEPENING_NODE_LIMIT 1000000ULL
+#define DEEPENING_CHECK_INTERVAL 1024   // nodes between two looks at the clock and the stop flag
+#define DEEPENING_WIN 1000000           // beyond every evaluation, minus the plies to the win
+#define ASPIRATION_WINDOW 128           // half width of the aspiration window
+// a win the tablebase proved, length unknown: below every counted win
+#define DEEPENING_TABLEBASE_WIN (DEEPENING_WIN - MAX_CELLS - 1)
+#define DEEPENING_PROVEN (DEEPENING_TABLEBASE_WIN - MAX_CELLS)
+
+typedef struct {
+    SearchContext *context;     // may be NULL
+    SearchStats *stats;
+    const Tablebase *tablebase; // may be NULL
+    SearchLine *lines;          // lines[ply] is the best line found below `ply`
+    SearchLine previous;        // pv of the last finished depth, searched first
+    int follow;                 // 1 while the current path is still on `previous`
+    unsigned long long nodes;
+    int aborted;
+} Deepening;
+
+static int position_empty_cells(const Board *board) {
+    return board->rows * board->cols - threat_count(board->stones[0] | board->stones[1]);
+}
+
+static void report_progress(SearchContext *context, int depth, int column, int score,
+                            const SearchStats *stats, const SearchLine *pv) {
+    if (context == NULL || context->progress == NULL) {
+        return;
+    }
+    SearchProgress progress = {depth, column, score, stats, pv};
+    context->progress(&progress, context->user);
+}
+
+// i-th column to try: center first, then alternating outwards
+static int center_column_at(const Board *board, int i) {
+    return board->cols / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2;
+}
+
+static int deepening_aborted(Deepening *search) {
+    search->nodes = search->nodes + 1;
+    if (!search->aborted && search->nodes % DEEPENING_CHECK_INTERVAL == 0) {
+        search->aborted = search->nodes >= DEEPENING_NODE_LIMIT || ai_context_expired(search->context);
+    }
+    return search->aborted;
+}
+
+// lines[ply] becomes `column` followed by the line below it
+static void extend_line(Deepening *search, int ply, int column) {
+    SearchLine *line = &search->lines[ply];
+    const SearchLine *rest = &search->lines[ply + 1];
+
+    line->moves[0] = column;
+    memcpy(line->moves + 1, rest->moves, (size_t)rest->length * sizeof(int));
+    line->length = rest->length + 1;
+}
+
+// score of `board` for `to_move` searched `depth` more plies, within [alpha, beta]
+// or a bound outside of it. meaningless once aborted
+static int deepening_negamax(Deepening *search, const Board *board, CellState to_move,
+                             int depth, int alpha, int beta, int ply) {
+    CellState opponent = (to_move == PLAYER1) ? PLAYER2 : PLAYER1;
+    ThreatMap map;
+
+    search->lines[ply].length = 0;
+    search_visit(search->stats, ply);
+    if (deepening_aborted(search)) {
+        return 0;
+    }
+
+    threat_analyze(board, &map);
+    if (threat_player(&map, to_move)->playable != 0) {
+        return DEEPENING_WIN - ply - 1;
+    }
+    Bitboard moves = threat_non_losing_moves(board, &map, to_move);
+    if (moves == 0) {
+        // a full board is a draw, otherwise the opponent wins with the next stone
+        return board_playable_cells(board) == 0 ? 0 : -(DEEPENING_WIN - ply - 2);
+    }
+    // the table knows the outcome, as deep as the game goes
+    if (ply > 0 && search->tablebase != NULL) {
+        TablebaseValue value = tablebase_probe(search->tablebase, board, to_move);
+        if (value != TABLEBASE_MISSING) {
+            if (search->stats != NULL) {
+                search->stats->tablebase_hits = search->stats->tablebase_hits + 1;
+            }
+            search->follow = 0;
+            if (value == TABLEBASE_DRAW) {
+                return 0;
+            }
+            return (value == TABLEBASE_WIN) ? DEEPENING_TABLEBASE_WIN - ply : -(DEEPENING_TABLEBASE_WIN - ply);
+        }
+    }
+    if (depth == 0) {
+        search->follow = 0;
+        return evaluate_threats(board, &map, to_move, to_move, search->stats);
+    }
+
+    // along the last pv its next move goes first
+    int pv_column = -1;
+    if (search->follow && ply < search->previous.length && move_in(board, moves, search->previous.moves[ply])) {
+        pv_column = search->previous.moves[ply];
+    } else {
+        search->follow = 0;
+    }
+
+    int searched = 0;
+    for (int i = -1; i < board->cols; i++) {
+        int column = (i < 0) ? pv_column : center_column_at(board, i);
+        if (column < 0 || (i >= 0 && column == pv_column) || !move_in(board, moves, column)) {
+            continue;
+        }
+        Board child = *board;
+        board_drop_piece(&child, column, to_move);
+
+        // principal variation search: the first move gets the whole window, the
+        // others a null window that only proves them worse. one that turns out
+        // better is searched again with the whole window
+        int score;
+        if (searched == 0) {
+            score = -deepening_negamax(search, &child, opponent, depth - 1, -beta, -alpha, ply + 1);
+            search->follow = 0;
+        } else {
+            score = -deepening_negamax(search, &child, opponent, depth - 1, -alpha - 1, -alpha, ply + 1);
+            if (score > alpha && score < beta && !search->aborted) {
+                score = -deepening_negamax(search, &child, opponent, depth - 1, -beta, -alpha, ply + 1);
+            }
+        }
+        searched = searched + 1;
+
+        if (search->aborted) {
+            return 0;
+        }
+        if (score >= beta) {
+            if (search->stats != NULL) {
+                search->stats->beta_cutoffs = search->stats->beta_cutoffs + 1;
+            }
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+            extend_line(search, ply, column);
+        }
+    }
+    return alpha;
+}
+
+static int deepening_search(const Board *board, CellState ai_player, SearchContext *context,
+                            SearchStats *stats, SearchLine *pv) {
+    Deepening search = {context, stats, current_tablebase(), NULL, {0}, 0, 0, 0};
+    ThreatMap map;
+    int best_column = -1;
+    int best_score = 0;
+    int scores[MAX_CELLS + 1];
+
+    threat_analyze(board, &map);
+    if (threat_player(&map, ai_player)->playable != 0) {
+        return first_column(board, threat_player(&map, ai_player)->playable);
+    }
+    Bitboard moves = search_moves(board, ai_player);
+    int forced = forced_column(board, moves);
+    if (forced != -1) {
+        return forced;
+    }
+    // every move loses, nothing to search for
+    if (threat_non_losing_moves(board, &map, ai_player) == 0) {
+        return first_column(board, moves);
+    }
+
+    // one line per ply, from the thread's arena
+    Arena *arena = arena_thread();
+    ArenaMark mark = {NULL, 0};
+    if (arena != NULL) {
+        mark = arena_mark(arena);
+        search.lines = (SearchLine *)arena_alloc(arena, (MAX_CELLS + 2) * sizeof(SearchLine));
+    }
+    if (search.lines == NULL) {
+        if (arena != NULL) {
+            arena_rewind(arena, mark);
+        }
+        return hard_search(board, ai_player, stats, search_rng(context));
+    }
+
+    for (int depth = 1; depth <= position_empty_cells(board) && !search.aborted; depth++) {
+        // aspiration: a window around the score two depths back, widened on the side
+        // it fails. the evaluation swings between odd and even depths, so the last
+        // depth with the same side to move at the leaves is the better guess
+        int alpha = -DEEPENING_WIN - 1;
+        int beta = DEEPENING_WIN + 1;
+        if (depth > 2) {
+            alpha = scores[depth - 2] - ASPIRATION_WINDOW;
+            beta = scores[depth - 2] + ASPIRATION_WINDOW;
+        }
+
+        int score;
+        while (1) {
+            search.follow = 1;
+            score = deepening_negamax(&search, board, ai_player, depth, alpha, beta, 0);
+            if (search.aborted) {
+                break;
+            }
+            if (score <= alpha) {
+                alpha = -DEEPENING_WIN - 1;
+            } else if (score >= beta) {
+                beta = DEEPENING_WIN + 1;
+            } else {
+                break;
+            }
+        }
+        if (search.aborted) {
+            break;
+        }
+
+        search.previous = search.lines[0];
+        best_column = search.previous.moves[0];
+        best_score = score;
+        scores[depth] = score;
+        report_progress(context, depth, best_column, best_score, stats, &search.previous);
+        // a win or a loss was proven, deeper searches wont change it
+        if (best_score >= DEEPENING_PROVEN || best_score <= -DEEPENING_PROVEN) {
+            break;
+        }
+    }
+    arena_rewind(arena, mark);
+
+    // stopped before the first depth was done
+    if (best_column == -1) {
+        return hard_search(board, ai_player, stats, search_rng(context));
+    }
+    if (pv != NULL) {
+        *pv = search.previous;
+    }
+    return best_column;
+}
+
+// perfect level: 32 MB of transposition table and a budget that keeps a move
+// well under a second; positions that need more are left to iterative deepening
+#define PERFECT_TT_LOG2 22
+#define PERFECT_NODE_LIMIT 2000000ULL
+
+// one table for the whole program so it carries over from one move to the
+// next. every search (the ponder thread, analysis threads) runs a solver of its
+// own on it; the table needs no lock. CONNECT4_TT_POLICY picks the replacement
+// scheme: always, depth or two-tier (the default)
+static pthread_once_t perfect_table_once = PTHREAD_ONCE_INIT;
+static TranspositionTable perfect_table;
+static int perfect_table_ready = 0;
+
+// guards the answers pondering found
+static pthread_mutex_t pondered_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    Board board;
+    CellState ai_player;
+    int column;
+} PonderedMove;
+
+static PonderedMove pondered[MAX_COLS];
+static int pondered_count = 0;
+
+static int same_position(const Board *a, const Board *b) {
+    return a->rows == b->rows && a->cols == b->cols && a->connect == b->connect &&
+           a->stones[0] == b->stones[0] && a->stones[1] == b->stones[1];
+}
+
+static void create_perfect_table(void) {
+    TableReplacement replacement = TABLE_TWO_TIER;
+    const char *name = getenv("CONNECT4_TT_POLICY");
+
+    if (name != NULL && !solver_parse_replacement(name, &replacement)) {
+        fprintf(stderr, "Unknown CONNECT4_TT_POLICY %s, using two-tier\n", name);
+    }
+    perfect_table_ready = solver_table_init(&perfect_table, PERFECT_TT_LOG2, replacement);
+}
+
+// a solver on the shared table, 0 if it could not be allocated
+static int init_perfect_solver(Solver *solver) {
+    pthread_once(&perfect_table_once, create_perfect_table);
+    if (!perfect_table_ready) {
+        return 0;
+    }
+    solver_init_shared(solver, &perfect_table);
+    return 1;
+}
+
+static int pondered_move(const Board *board, CellState ai_player) {
+    int column = -1;
+
+    pthread_mutex_lock(&pondered_lock);
+    for (int i = 0; i < pondered_count && column < 0; i++) {
+        if (pondered[i].ai_player == ai_player && same_position(&pondered[i].board, board)) {
+            column = pondered[i].column;
+        }
+    }
+    pthread_mutex_unlock(&pondered_lock);
+    return column;
+}
+
+static int solve_move(Solver *solver, const Board *board, CellState ai_player,
+                      SearchContext *context, SearchStats *stats) {
+    Position position;
+    int score = 0;
+
+    solver->stats = stats;
+    solver->node_limit = PERFECT_NODE_LIMIT;
+    if (context != NULL) {
+        solver->stop = &context->stop;
+        // under a deadline, half of the time left is kept for iterative deepening
+        if (context->deadline_ns != 0) {
+            unsigned long long now = monotonic_ns();
+            solver->deadline_ns = now + (context->deadline_ns > now ? (context->deadline_ns - now) / 2 : 0);
+        }
+    }
+    solver_position_from_board(&position, board, ai_player);
+    int column = solver_best_move(solver, &position, &score);
+    if (context != NULL) {
+        solver->stop = NULL;
+        solver->deadline_ns = 0;
+    }
+    solver->stats = NULL;
+
+    if (column >= 0) {
+        // exact, as deep as the game goes
+        report_progress(context, position_empty_cells(board), column, score, stats, NULL);
+    }
+    return column;
+}
+
+static int perfect_search(const Board *board, CellState ai_player, SearchContext *context,
+                          SearchStats *stats, SearchLine *pv) {
+    Solver solver;
+    int column = -1;
+
+    // the solver only knows the standard board
+    if (solver_supports(board)) {
+        column = pondered_move(board, ai_player);
+        if (column < 0 && init_perfect_solver(&solver)) {
+            column = solve_move(&solver, board, ai_player, context, stats);
+        }
+    }
+
+    if (column < 0) {
+        column = deepening_search(board, ai_player, context, stats, pv);
+    }
+    return column;
+}
+
+// mcts level: one engine for the whole program so the tree carries over from
+// one move to the next. a search that finds it busy (analysis threads) gets a
+// throwaway engine of its own
+static pthread_mutex_t mcts_lock = PTHREAD_MUTEX_INITIALIZER;
+static MctsEngine mcts_engine;
+static int mcts_ready = 0;
+
+// CONNECT4_MCTS_PLAYOUTS, CONNECT4_MCTS_THREADS and CONNECT4_MCTS_TIME_MS tune the strength
+static void mcts_config_from_env(MctsConfig *config) {
+    const char *value;
+
+    mcts_default_config(config);
+    if ((value = getenv("CONNECT4_MCTS_PLAYOUTS")) != NULL && atol(value) > 0) {
+        config->playouts = (unsigned long)atol(value);
+    }
+    if ((value = getenv("CONNECT4_MCTS_THREADS")) != NULL && atoi(value) > 0) {
+        config->threads = atoi(value);
+    }
+    if ((value = getenv("CONNECT4_MCTS_TIME_MS")) != NULL && atol(value) > 0) {
+        config->time_limit_ns = (unsigned long long)atol(value) * 1000000ULL;
+    }
+}
+
+// callers hold mcts_lock
+static int ensure_mcts(void) {
+    MctsConfig config;
+
+    if (!mcts_ready) {
+        mcts_config_from_env(&config);
+        mcts_ready = mcts_init(&mcts_engine, &config);
+    }
+    return mcts_ready;
+}
+
+// with a progress callback the playouts are spent in slices, each followed by a
+// report. the tree carries over from slice to slice, so the move is the same as
+// with a single search
+#define MCTS_PROGRESS_STEPS 8
+
+static int mcts_run(MctsEngine *engine, const Board *board, CellState ai_player,
+                    SearchContext *context, SearchStats *stats, SearchLine *pv) {
+    SearchLine line = {0};
+    int column;
+
+    if (context == NULL) {
+        column = mcts_best_move(engine, board, ai_player, stats);
+        if (pv != NULL) {
+            pv->length = mcts_principal_variation(engine, column, pv->moves, MAX_CELLS);
+        }
+        return column;
+    }
+    engine->stop = &context->stop;
+    engine->deadline_ns = context->deadline_ns;
+
+    if (context->progress == NULL) {
+        column = mcts_best_move(engine, board, ai_player, stats);
+    } else {
+        MctsConfig config = engine->config;
+        unsigned long spent = 0;
+
+        // the time limit holds for the whole search, not for each slice
+        if (config.time_limit_ns != 0) {
+            unsigned long long deadline = monotonic_ns() + config.time_limit_ns;
+            if (engine->deadline_ns == 0 || deadline < engine->deadline_ns) {
+                engine->deadline_ns = deadline;
+            }
+            engine->config.time_limit_ns = 0;
+        }
+        for (int step = 1; step <= MCTS_PROGRESS_STEPS; step++) {
+            SearchStats slice = {0};
+            engine->config.playouts = config.playouts * step / MCTS_PROGRESS_STEPS - spent;
+            spent = spent + engine->config.playouts;
+            column = mcts_best_move(engine, board, ai_player, &slice);
+            if (stats != NULL) {
+                stats->nodes = stats->nodes + slice.nodes;
+                stats->leaf_evaluations = stats->leaf_evaluations + slice.leaf_evaluations;
+                if (slice.max_depth > stats->max_depth) {
+                    stats->max_depth = slice.max_depth;
+                }
+            }
+            line.length = mcts_principal_variation(engine, column, line.moves, MAX_CELLS);
+            report_progress(context, slice.max_depth, column,
+                            (int)(1000.0 * mcts_column_value(engine, column)), stats, &line);
+            if (column < 0 || ai_context_expired(context)) {
+                break;
+            }
+        }
+        engine->config = config;
+    }
+
+    engine->stop = NULL;
+    engine->deadline_ns = 0;
+    if (pv != NULL) {
+        pv->length = mcts_principal_variation(engine, column, pv->moves, MAX_CELLS);
+    }
+    return column;
+}
+
+static int mcts_search(const Board *board, CellState ai_player, SearchContext *context,
+                       SearchStats *stats, SearchLine *pv) {
+    MctsConfig config;
+    ThreatMap map;
+    int column = -1;
+
+    // wins and forced blocks dont need a tree
+    threat_analyze(board, &map);
+    if (threat_player(&map, ai_player)->playable != 0) {
+        return first_column(board, threat_player(&map, ai_player)->playable);
+    }
+    int forced = forced_column(board, search_moves(board, ai_player));
+    if (forced != -1) {
+        return forced;
+    }
+
+    // the playouts draw from the game's or the context's generator, so a seed replays them
+    uint64_t seed = rng_next(search_rng(context));
+    if (pthread_mutex_trylock(&mcts_lock) == 0) {
+        if (ensure_mcts()) {
+            // a pondered position may already have the playouts of a whole search
+            column = mcts_cached_move(&mcts_engine, board, ai_player, mcts_engine.config.playouts);
+            if (column < 0) {
+                mcts_seed(&mcts_engine, seed);
+                column = mcts_run(&mcts_engine, board, ai_player, context, stats, pv);
+            }
+        }
+        pthread_mutex_unlock(&mcts_lock);
+    } else {
+        // the pools come from this thread's arena and go back to it after the move
+        MctsEngine engine;
+        Arena *arena = arena_thread();
+        mcts_config_from_env(&config);
+        config.threads = 1;
+        if (arena != NULL) {
+            ArenaMark mark = arena_mark(arena);
+            if (mcts_init_arena(&engine, &config, arena)) {
+                mcts_seed(&engine, seed);
+                column = mcts_run(&engine, board, ai_player, context, stats, pv);
+            }
+            arena_rewind(arena, mark);
+        }
+    }
+
+    if (column < 0) {
+        column = expert_search(board, ai_player, stats, search_rng(context));
+    }
+    return column;
+}
+
+int ai_medium(const Board *board, CellState ai_player) {
+    return medium_search(board, ai_player, NULL, rng_thread());
+}
+
+int ai_hard(const Board *board, CellState ai_player) {
+    return hard_search(board, ai_player, NULL, rng_thread());
+}
+
+int ai_expert(const Board *board, CellState ai_player) {
+    return expert_search(board, ai_player, NULL, rng_thread());
+}
+
+int ai_perfect(const Board *board, CellState ai_player) {
+    return perfect_search(board, ai_player, NULL, NULL, NULL);
+}
+
+int ai_mcts(const Board *board, CellState ai_player) {
+    return mcts_search(board, ai_player, NULL, NULL, NULL);
+}
+
+int ai_search(const Board *board, CellState ai_player, AILevel level, SearchResult *result) {
+    return ai_search_context(board, ai_player, level, NULL, result);
+}
+
+void ai_context_init(SearchContext *context) {
+    atomic_init(&context->stop, 0);
+    context->deadline_ns = 0;
+    context->progress = NULL;
+    context->user = NULL;
+    context->rng = NULL;
+}
+
+void ai_context_set_time_limit(SearchContext *context, unsigned long long time_limit_ns) {
+    context->deadline_ns = time_limit_ns ? monotonic_ns() + time_limit_ns : 0;
+}
+
+void ai_context_from_env(SearchContext *context) {
+    const char *value = getenv("CONNECT4_AI_TIME_MS");
+    if (value != NULL && atol(value) > 0) {
+        ai_context_set_time_limit(context, (unsigned long long)atol(value) * 1000000ULL);
+    }
+}
+
+void ai_context_stop(SearchContext *context) {
+    atomic_store(&context->stop, 1);
+}
+
+int ai_context_expired(const SearchContext *context) {
+    if (context == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&context->stop, memory_order_relaxed) ||
+           (context->deadline_ns != 0 && monotonic_ns() >= context->deadline_ns);
+}
+
+int ai_search_context(const Board *board, CellState ai_player, AILevel level,
+                      SearchContext *context, SearchResult *result) {
+    SearchStats stats = {0};
+    SearchLine pv = {0};
+    unsigned long long start = monotonic_ns();
+    int column;
+
+    switch (level) {
+        case AI_EASY:   column = easy_search(board, search_rng(context)); break;
+        case AI_MEDIUM: column = medium_search(board, ai_player, &stats, search_rng(context)); break;
+        case AI_HARD:   column = hard_search(board, ai_player, &stats, search_rng(context)); break;
+        case AI_EXPERT: column = expert_search(board, ai_player, &stats, search_rng(context)); break;
+        case AI_MCTS:   column = mcts_search(board, ai_player, context, &stats, &pv); break;
+        default:        column = perfect_search(board, ai_player, context, &stats, &pv); break;
+    }
+
+    stats.elapsed_ns = monotonic_ns() - start;
+    if (stats.elapsed_ns > 0) {
+        stats.nodes_per_second = (double)stats.nodes * 1e9 / (double)stats.elapsed_ns;
+    }
+
+    // searches without a line of their own still stand behind their move
+    if (pv.length == 0 && column >= 0) {
+        pv.moves[0] = column;
+        pv.length = 1;
+    }
+
+    if (result != NULL) {
+        result->column = column;
+        result->stats = stats;
+        result->pv = pv;
+    }
+    return column;
+}
+
+/* pondering */
+
+// rounds of mcts search on the opponent's position, each one the budget of a move
+#define PONDER_MCTS_ROUNDS 8
+
+static void ponder_perfect(Ponder *ponder) {
+    CellState opponent = (ponder->ai_player == PLAYER1) ? PLAYER2 : PLAYER1;
+    int order[MAX_COLS];
+    int count = 0;
+
+    // the reply the expert would play is the likeliest, then center out
+    int predicted = expert_search(&ponder->board, opponent, NULL, rng_thread());
+    order[count++] = predicted;
+    for (int i = 0; i < ponder->board.cols; i++) {
+        int column = ponder->board.cols / 2 + ((i % 2) ? -(i + 1) / 2 : i / 2);
+        if (column != predicted) {
+            order[count++] = column;
+        }
+    }
+
+    Solver solver;
+    if (!init_perfect_solver(&solver)) {
+        return;
+    }
+    solver.stop = &ponder->stop;
+
+    pthread_mutex_lock(&pondered_lock);
+    pondered_count = 0;
+    pthread_mutex_unlock(&pondered_lock);
+
+    for (int i = 0; i < count && !atomic_load(&ponder->stop); i++) {
+        Board next = ponder->board;
+        if (board_drop_piece(&next, order[i], opponent) < 0 ||
+            board_check_winner(&next, opponent) == 1 || board_playable_cells(&next) == 0) {
+            continue;
+        }
+        // an unfinished solve still leaves its table entries for the real search
+        int column = solve_move(&solver, &next, ponder->ai_player, NULL, NULL);
+        if (column >= 0) {
+            pthread_mutex_lock(&pondered_lock);
+            pondered[pondered_count].board = next;
+            pondered[pondered_count].ai_player = ponder->ai_player;
+            pondered[pondered_count].column = column;
+            pondered_count = pondered_count + 1;
+            pthread_mutex_unlock(&pondered_lock);
+        }
+    }
+}
+
+static void ponder_mcts(Ponder *ponder) {
+    CellState opponent = (ponder->ai_player == PLAYER1) ? PLAYER2 : PLAYER1;
+
+    pthread_mutex_lock(&mcts_lock);
+    if (ensure_mcts()) {
+        // searching the opponent's position grows the subtree of every reply,
+        // the next search starts from the one that was played
+        mcts_engine.stop = &ponder->stop;
+        mcts_seed(&mcts_engine, rng_next(rng_thread()));
+        for (int i = 0; i < PONDER_MCTS_ROUNDS && !atomic_load(&ponder->stop); i++) {
+            mcts_best_move(&mcts_engine, &ponder->board, opponent, NULL);
+        }
+        mcts_engine.stop = NULL;
+    }
+    pthread_mutex_unlock(&mcts_lock);
+}
+
+static void *ponder_thread(void *arg) {
+    Ponder *ponder = (Ponder *)arg;
+
+    if (ponder->level == AI_MCTS) {
+        ponder_mcts(ponder);
+    } else {
+        ponder_perfect(ponder);
+    }
+    return NULL;
+}
+
+void ai_ponder_init(Ponder *ponder) {
+    ponder->running = 0;
+    atomic_init(&ponder->stop, 0);
+}
+
+int ai_ponder_start(Ponder *ponder, const Board *board, CellState ai_player, AILevel level) {
+    const char *enabled = getenv("CONNECT4_PONDER");
+
+    ai_ponder_stop(ponder);
+    if (enabled != NULL && atoi(enabled) == 0) {
+        return 0;
+    }
+    if (!(level == AI_MCTS || (level == AI_PERFECT && solver_supports(board))) ||
+        board_playable_cells(board) == 0) {
+        return 0;
+    }
+
+    ponder->board = *board;
+    ponder->ai_player = ai_player;
+    ponder->level = level;
+    atomic_store(&ponder->stop, 0);
+    ponder->running = pthread_create(&ponder->thread, NULL, ponder_thread, ponder) == 0;
+    return ponder->running;
+}
+
+void ai_ponder_wait(Ponder *ponder) {
+    if (ponder->running) {
+        pthread_join(ponder->thread, NULL);
+        ponder->running = 0;
+    }
+}
+
+void ai_ponder_stop(Ponder *ponder) {
+    atomic_store(&ponder->stop, 1);
+    ai_ponder_wait(ponder);
+}
+
+void ai_print_stats(FILE *out, const SearchStats *stats) {
+    fprintf(out,
+            "nodes=%llu leaves=%llu tt_probes=%llu tt_hits=%llu tt_stores=%llu "
+            "tt_collisions=%llu tt_overwrites=%llu "
+            "cutoffs=%llu tablebase_hits=%llu depth=%d time_ns=%llu nps=%.0f\n",
+            stats->nodes, stats->leaf_evaluations,
+            stats->tt_probes, stats->tt_hits, stats->tt_stores,
+            stats->tt_collisions, stats->tt_overwrites,
+            stats->beta_cutoffs, stats->tablebase_hits, stats->max_depth,
+            stats->elapsed_ns, stats->nodes_per_second);
+}
+
+void *ai_thread_function(void *arg) {
+    AIThread *task = (AIThread *)arg;
+
+    SearchResult result;
+
+    task->result = ai_search_context(&task->board_copy, task->ai_player, task->ai_level, task->context, &result);
+    task->stats = result.stats;
 
     return NULL;
 }
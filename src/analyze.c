@@ -0,0 +1,513 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "board.h"
+#include "ai.h"
+#include "solver.h"
+#include "archive.h"
+#include "workqueue.h"
+
+// Batch analysis of positions: reader -> workers -> writer, connected by
+// bounded queues. A fixed pool of job slots circulates through the stages so
+// memory use does not depend on the size of the input.
+
+#define MAX_MOVES_TEXT 128
+#define JOBS_PER_WORKER 16
+#define SHARED_TT_LOG2 23
+#define DEFAULT_SOLVE_NODES 1000000ULL
+
+typedef struct {
+    unsigned long seq;
+    char id[32];
+    char moves[MAX_MOVES_TEXT];
+    const char *status;
+    int solved;
+    int score;  // exact solver score for the side to move, valid if solved
+    int eval;
+    int best;   // 0-based column, -1 if there is no move to make
+    SearchStats stats;
+    SearchLine pv;
+} AnalysisJob;
+
+typedef struct {
+    WorkQueue free_jobs;
+    WorkQueue pending;
+    WorkQueue done;
+    AnalysisJob *jobs;
+    size_t job_count;
+    AILevel level;
+    BoardConfig config;     // geometry of every position
+    unsigned long long solve_nodes;
+    TranspositionTable table;   // shared by the workers' solvers, valid if solve_nodes > 0
+    unsigned long long time_limit_ns;   // per AI search, 0 = none
+    int show_progress;
+    int show_pv;
+    int show_stats;
+    FILE *out;
+} Pipeline;
+
+static CellState other_player(CellState player) {
+    return (player == PLAYER1) ? PLAYER2 : PLAYER1;
+}
+
+static int has_immediate_win(const Board *board, CellState player) {
+    return (board_winning_cells(board, player) & board_playable_cells(board)) != 0;
+}
+
+// Fallback when the solver runs out of nodes. What can be proven with a two ply
+// look: a win if the side to move has a winning drop, a loss if every move
+// hands the opponent one.
+static const char *shallow_status(const Board *board, CellState to_move) {
+    CellState opponent = other_player(to_move);
+
+    if (has_immediate_win(board, to_move)) {
+        return "win";
+    }
+
+    for (int column = 0; column < board->cols; column++) {
+        if (board_is_valid_move(board, column) == 1) {
+            Board temporary_board = *board;
+            board_drop_piece(&temporary_board, column, to_move);
+            if (board_is_full(&temporary_board) || !has_immediate_win(&temporary_board, opponent)) {
+                return "unknown";
+            }
+        }
+    }
+    return "loss";
+}
+
+// A line of 0-based columns as a move string (1-based), "-" if it is empty
+static void format_line(const SearchLine *line, char *text, size_t size) {
+    size_t length = 0;
+    for (int i = 0; i < line->length && length + 1 < size; i++) {
+        text[length++] = (char)('1' + line->moves[i]);
+    }
+    if (length == 0 && size > 1) {
+        text[length++] = '-';
+    }
+    text[length] = '\0';
+}
+
+// -p: one line on stderr per completed depth of the AI search, as it happens
+static void print_progress(const SearchProgress *progress, void *user) {
+    const AnalysisJob *job = (const AnalysisJob *)user;
+    char pv[MAX_CELLS + 1] = "-";
+
+    if (progress->pv != NULL) {
+        format_line(progress->pv, pv, sizeof(pv));
+    }
+    fprintf(stderr, "%s\tdepth %d\tbest %d\tscore %d\tnodes %llu\tpv %s\n", job->id, progress->depth,
+            progress->column + 1, progress->score, progress->stats->nodes, pv);
+}
+
+static void analyze_job(AnalysisJob *job, const Pipeline *pipeline, Solver *solver) {
+    Board board;
+    CellState to_move;
+    SearchResult result;
+    SearchContext context;
+    Position position;
+    Rng rng;
+
+    job->solved = 0;
+    job->score = 0;
+    job->eval = 0;
+    job->best = -1;
+    memset(&job->stats, 0, sizeof(job->stats));
+    job->pv.length = 0;
+
+    if (board_play_moves_config(&board, &pipeline->config, job->moves, &to_move) < 0) {
+        job->status = "invalid";
+        return;
+    }
+
+    CellState opponent = other_player(to_move);
+    if (board_check_winner(&board, opponent)) {
+        job->status = "lost";
+        return;
+    }
+    if (board_is_full(&board)) {
+        job->status = "draw";
+        return;
+    }
+
+    job->eval = score_position(&board, to_move) - score_position(&board, opponent);
+    ai_context_init(&context);
+    ai_context_set_time_limit(&context, pipeline->time_limit_ns);
+    // a position gets the same random moves whichever worker takes it
+    rng_seed(&rng, board.stones[0] ^ (board.stones[1] * RNG_DEFAULT_SEED));
+    context.rng = &rng;
+    if (pipeline->show_progress) {
+        context.progress = print_progress;
+        context.user = job;
+    }
+    job->best = ai_search_context(&board, to_move, pipeline->level, &context, &result);
+    job->stats = result.stats;
+    job->pv = result.pv;
+
+    if (solver != NULL && solver_supports(&board)) {
+        solver->node_limit = pipeline->solve_nodes;
+        solver_position_from_board(&position, &board, to_move);
+        job->solved = solver_solve(solver, &position, &job->score);
+    }
+
+    if (job->solved) {
+        if (job->score > 0) {
+            job->status = "win";
+        } else if (job->score < 0) {
+            job->status = "loss";
+        } else {
+            job->status = "draw";
+        }
+    } else {
+        job->status = shallow_status(&board, to_move);
+    }
+}
+
+static void *worker_thread(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    AnalysisJob *job;
+    Solver solver;
+    Solver *solver_ptr = NULL;
+
+    // one table for all workers, kept across positions so related positions share entries
+    if (pipeline->solve_nodes > 0) {
+        solver_init_shared(&solver, &pipeline->table);
+        solver_ptr = &solver;
+    }
+
+    while ((job = (AnalysisJob *)workqueue_pop(&pipeline->pending)) != NULL) {
+        analyze_job(job, pipeline, solver_ptr);
+        workqueue_push(&pipeline->done, job);
+    }
+    return NULL;
+}
+
+// Results arrive in completion order; they are written back in input order.
+// At most job_count jobs are in flight, so seq % job_count never collides.
+static void *writer_thread(void *arg) {
+    Pipeline *pipeline = (Pipeline *)arg;
+    AnalysisJob **reorder = (AnalysisJob **)calloc(pipeline->job_count, sizeof(AnalysisJob *));
+    unsigned long next_seq = 0;
+    AnalysisJob *job;
+
+    if (reorder == NULL) {
+        fprintf(stderr, "connect4_analyze: out of memory\n");
+        exit(1);
+    }
+
+    while ((job = (AnalysisJob *)workqueue_pop(&pipeline->done)) != NULL) {
+        reorder[job->seq % pipeline->job_count] = job;
+
+        while ((job = reorder[next_seq % pipeline->job_count]) != NULL && job->seq == next_seq) {
+            reorder[next_seq % pipeline->job_count] = NULL;
+
+            fprintf(pipeline->out, "%s\t%s\t%s\t", job->id, job->moves, job->status);
+            if (job->solved) {
+                fprintf(pipeline->out, "%d\t", job->score);
+            } else {
+                fprintf(pipeline->out, "-\t");
+            }
+            fprintf(pipeline->out, "%d\t", job->eval);
+            if (job->best >= 0) {
+                fprintf(pipeline->out, "%d", job->best + 1);
+            } else {
+                fprintf(pipeline->out, "-");
+            }
+            if (pipeline->show_pv) {
+                char pv[MAX_CELLS + 1];
+                format_line(&job->pv, pv, sizeof(pv));
+                fprintf(pipeline->out, "\t%s", pv);
+            }
+            if (pipeline->show_stats) {
+                fprintf(pipeline->out, "\t%llu\t%llu\t%d\t%llu",
+                        job->stats.nodes, job->stats.leaf_evaluations,
+                        job->stats.max_depth, job->stats.elapsed_ns);
+            }
+            fprintf(pipeline->out, "\n");
+
+            workqueue_push(&pipeline->free_jobs, job);
+            next_seq = next_seq + 1;
+        }
+    }
+
+    free(reorder);
+    return NULL;
+}
+
+static void submit(Pipeline *pipeline, unsigned long seq, const char *id, const char *moves) {
+    AnalysisJob *job = (AnalysisJob *)workqueue_pop(&pipeline->free_jobs);
+
+    job->seq = seq;
+    snprintf(job->id, sizeof(job->id), "%s", id);
+    snprintf(job->moves, sizeof(job->moves), "%s", moves);
+    workqueue_push(&pipeline->pending, job);
+}
+
+// One position per line; only the first token is used so solver test files
+// ("moves expected_score") can be fed in directly. Blank and '#' lines are skipped.
+static unsigned long read_text_positions(Pipeline *pipeline, FILE *in) {
+    char line[256];
+    char id[32];
+    unsigned long seq = 0;
+    unsigned long line_number = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_number = line_number + 1;
+
+        char *p = line;
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        char *end = p;
+        while (*end && !isspace((unsigned char)*end)) end++;
+        *end = '\0';
+
+        if (strlen(p) >= MAX_MOVES_TEXT) {
+            fprintf(stderr, "connect4_analyze: line %lu is too long, skipped\n", line_number);
+            continue;
+        }
+
+        snprintf(id, sizeof(id), "%lu", line_number);
+        submit(pipeline, seq, id, p);
+        seq = seq + 1;
+    }
+    return seq;
+}
+
+// Every position of every archived game, from the empty board to the final move
+static unsigned long read_archive_positions(Pipeline *pipeline, const GameArchive *archive) {
+    char moves[MAX_MOVES_TEXT];
+    char id[32];
+    unsigned long seq = 0;
+
+    for (size_t game = 0; game < archive_game_count(archive); game++) {
+        Move *head = NULL;
+        if (!archive_load_moves(archive, game, &head)) {
+            fprintf(stderr, "connect4_analyze: game %zu is corrupt, skipped\n", game);
+            continue;
+        }
+
+        int ply = 0;
+        const Move *current = head;
+        while (1) {
+            moves[ply] = '\0';
+            snprintf(id, sizeof(id), "%zu.%d", game, ply);
+            submit(pipeline, seq, id, moves);
+            seq = seq + 1;
+
+            if (current == NULL) {
+                break;
+            }
+            moves[ply] = (char)('1' + current->col);
+            ply = ply + 1;
+            current = current->next;
+        }
+
+        history_free(&head);
+    }
+    return seq;
+}
+
+static int parse_level(const char *text, AILevel *level) {
+    if (strcmp(text, "easy") == 0 || strcmp(text, "1") == 0) {
+        *level = AI_EASY;
+    } else if (strcmp(text, "medium") == 0 || strcmp(text, "2") == 0) {
+        *level = AI_MEDIUM;
+    } else if (strcmp(text, "hard") == 0 || strcmp(text, "3") == 0) {
+        *level = AI_HARD;
+    } else if (strcmp(text, "expert") == 0 || strcmp(text, "4") == 0) {
+        *level = AI_EXPERT;
+    } else if (strcmp(text, "perfect") == 0 || strcmp(text, "5") == 0) {
+        *level = AI_PERFECT;
+    } else if (strcmp(text, "mcts") == 0 || strcmp(text, "6") == 0) {
+        *level = AI_MCTS;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-l easy|medium|hard|expert|perfect|mcts] [-n solve_nodes] [-r always|depth|two-tier] [-m time_ms] [-g geometry] [-o output] [-a] [-p] [-v] [-s] [input]\n"
+            "  input   file of move strings (1-based columns), one per line; stdin if omitted\n"
+            "  -a      input is a binary game archive, every position of every game is analyzed\n"
+            "  -g      board as <cols>x<rows>[:connect] (default 7x6:4); archives carry their own\n"
+            "  -n      node budget of the exact solver per position (default 1000000, 0 disables it;\n"
+            "          the solver only handles 7x6)\n"
+            "  -r      replacement scheme of the solver table the threads share (default two-tier)\n"
+            "  -m      time limit of the AI search per position in milliseconds (default none)\n"
+            "  -p      report every completed depth of the AI search on stderr\n"
+            "  -v      append the principal variation, the line the AI expects (1-based columns)\n"
+            "  -s      append search statistics: nodes, leaf evaluations, depth, time (ns)\n"
+            "Output columns: id, moves, status, score, eval, best column (1-based)\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    Pipeline pipeline;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *output_path = NULL;
+    int archive_input = 0;
+    TableReplacement replacement = TABLE_TWO_TIER;
+    int opt;
+
+    pipeline.level = AI_EXPERT;
+    pipeline.solve_nodes = DEFAULT_SOLVE_NODES;
+    pipeline.time_limit_ns = 0;
+    pipeline.show_progress = 0;
+    pipeline.show_pv = 0;
+    pipeline.show_stats = 0;
+    pipeline.config = BOARD_STANDARD;
+
+    while ((opt = getopt(argc, argv, "t:l:n:r:m:g:o:apvsh")) != -1) {
+        switch (opt) {
+            case 't':
+                threads = strtol(optarg, NULL, 10);
+                break;
+            case 'l':
+                if (!parse_level(optarg, &pipeline.level)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n':
+                pipeline.solve_nodes = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                if (!solver_parse_replacement(optarg, &replacement)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'm':
+                pipeline.time_limit_ns = strtoull(optarg, NULL, 10) * 1000000ULL;
+                break;
+            case 'g':
+                if (!board_config_parse(optarg, &pipeline.config)) {
+                    fprintf(stderr, "connect4_analyze: invalid geometry %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'a':
+                archive_input = 1;
+                break;
+            case 'p':
+                pipeline.show_progress = 1;
+                break;
+            case 'v':
+                pipeline.show_pv = 1;
+                break;
+            case 's':
+                pipeline.show_stats = 1;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    const char *input_path = (optind < argc) ? argv[optind] : NULL;
+    if (archive_input && input_path == NULL) {
+        fprintf(stderr, "connect4_analyze: -a needs an archive file\n");
+        return 1;
+    }
+
+    GameArchive archive;
+    FILE *in = stdin;
+    if (archive_input) {
+        if (!archive_open(&archive, input_path)) {
+            fprintf(stderr, "connect4_analyze: cannot open archive %s\n", input_path);
+            return 1;
+        }
+        pipeline.config = archive.config;
+    } else if (input_path != NULL) {
+        in = fopen(input_path, "r");
+        if (in == NULL) {
+            perror(input_path);
+            return 1;
+        }
+    }
+
+    pipeline.out = stdout;
+    if (output_path != NULL) {
+        pipeline.out = fopen(output_path, "w");
+        if (pipeline.out == NULL) {
+            perror(output_path);
+            return 1;
+        }
+    }
+
+    pipeline.job_count = (size_t)threads * JOBS_PER_WORKER;
+    pipeline.jobs = (AnalysisJob *)calloc(pipeline.job_count, sizeof(AnalysisJob));
+    pthread_t *workers = (pthread_t *)malloc((size_t)threads * sizeof(pthread_t));
+    if (pipeline.jobs == NULL || workers == NULL ||
+        !workqueue_init(&pipeline.free_jobs, pipeline.job_count) ||
+        !workqueue_init(&pipeline.pending, pipeline.job_count) ||
+        !workqueue_init(&pipeline.done, pipeline.job_count) ||
+        (pipeline.solve_nodes > 0 && !solver_table_init(&pipeline.table, SHARED_TT_LOG2, replacement))) {
+        fprintf(stderr, "connect4_analyze: out of memory\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < pipeline.job_count; i++) {
+        workqueue_push(&pipeline.free_jobs, &pipeline.jobs[i]);
+    }
+
+    fprintf(pipeline.out, "# id\tmoves\tstatus\tscore\teval\tbest%s%s\n",
+            pipeline.show_pv ? "\tpv" : "",
+            pipeline.show_stats ? "\tnodes\tleaves\tdepth\ttime_ns" : "");
+
+    pthread_t writer;
+    pthread_create(&writer, NULL, writer_thread, &pipeline);
+    for (long i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, worker_thread, &pipeline);
+    }
+
+    unsigned long total;
+    if (archive_input) {
+        total = read_archive_positions(&pipeline, &archive);
+    } else {
+        total = read_text_positions(&pipeline, in);
+    }
+
+    workqueue_close(&pipeline.pending);
+    for (long i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    workqueue_close(&pipeline.done);
+    pthread_join(writer, NULL);
+
+    fprintf(stderr, "connect4_analyze: %lu position(s) analyzed with %ld thread(s)\n", total, threads);
+
+    if (archive_input) {
+        archive_close(&archive);
+    } else if (in != stdin) {
+        fclose(in);
+    }
+    if (pipeline.out != stdout) {
+        fclose(pipeline.out);
+    }
+
+    workqueue_destroy(&pipeline.free_jobs);
+    workqueue_destroy(&pipeline.pending);
+    workqueue_destroy(&pipeline.done);
+    if (pipeline.solve_nodes > 0) {
+        solver_table_free(&pipeline.table);
+    }
+    free(pipeline.jobs);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,372 @@
+#include "archive.h"
+#include "board.h"
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const unsigned char ARCHIVE_MAGIC[4] = {'C', '4', 'A', 'R'};
+static const unsigned char INDEX_MAGIC[4] = {'C', '4', 'A', 'I'};
+
+#define INDEX_HEADER_SIZE 24
+
+static void put_u64(unsigned char *out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_u64(const unsigned char *in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+// "<archive>.idx", caller frees
+static char *index_path(const char *filename) {
+    size_t len = strlen(filename);
+    char *path = (char *)malloc(len + 5);
+    if (path == NULL) {
+        return NULL;
+    }
+    memcpy(path, filename, len);
+    memcpy(path + len, ".idx", 5);
+    return path;
+}
+
+// Geometry stored in an archive header, 0 if the header is not valid
+static int read_header(const unsigned char *header, BoardConfig *config) {
+    if (memcmp(header, ARCHIVE_MAGIC, 4) != 0 || header[4] != ARCHIVE_VERSION) {
+        return 0;
+    }
+
+    config->rows = header[5];
+    config->cols = header[6];
+    config->connect = (header[7] == 0) ? 4 : header[7];
+    return board_config_valid(config);
+}
+
+int archive_append_game(const char *filename, const BoardConfig *config, const Move *head) {
+    unsigned char record[1 + MAX_ROWS * MAX_COLS];
+    int count = 0;
+
+    if (!board_config_valid(config)) {
+        return 0;
+    }
+
+    for (const Move *current = head; current != NULL; current = current->next) {
+        if (count >= config->rows * config->cols || current->col < 0 || current->col >= config->cols) {
+            return 0;
+        }
+        record[1 + count] = (unsigned char)((current->player << 4) | current->col);
+        count++;
+    }
+    record[0] = (unsigned char)count;
+
+    // Writes always go to the end, reads are only for the existing header
+    FILE *file = fopen(filename, "a+b");
+    if (file == NULL) {
+        return 0;
+    }
+
+    unsigned char header[ARCHIVE_HEADER_SIZE] = {0};
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        // An empty file gets the header first
+        memcpy(header, ARCHIVE_MAGIC, 4);
+        header[4] = ARCHIVE_VERSION;
+        header[5] = (unsigned char)config->rows;
+        header[6] = (unsigned char)config->cols;
+        header[7] = (unsigned char)config->connect;
+        if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+            fclose(file);
+            return 0;
+        }
+    } else {
+        BoardConfig stored;
+        fseek(file, 0, SEEK_SET);
+        if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+            !read_header(header, &stored) || stored.rows != config->rows ||
+            stored.cols != config->cols || stored.connect != config->connect) {
+            fclose(file);
+            return 0;
+        }
+        fseek(file, 0, SEEK_END);  // switching from reading to writing
+    }
+
+    size_t written = fwrite(record, 1, (size_t)count + 1, file);
+    if (fclose(file) != 0 || written != (size_t)count + 1) {
+        return 0;
+    }
+    return 1;
+}
+
+static int push_offset(GameArchive *archive, size_t *capacity, uint64_t offset) {
+    if (archive->game_count == *capacity) {
+        size_t new_capacity = (*capacity == 0) ? 1024 : *capacity * 2;
+        uint64_t *grown = (uint64_t *)realloc(archive->offsets, new_capacity * sizeof(uint64_t));
+        if (grown == NULL) {
+            return 0;
+        }
+        archive->offsets = grown;
+        *capacity = new_capacity;
+    }
+    archive->offsets[archive->game_count] = offset;
+    archive->game_count = archive->game_count + 1;
+    return 1;
+}
+
+// Walk record headers from `start` to the end of the mapping. Only the
+// length byte of each record is touched, the moves themselves are skipped.
+// A truncated trailing record (interrupted append) is ignored.
+static int scan_records(GameArchive *archive, size_t *capacity, uint64_t start) {
+    uint64_t pos = start;
+
+    while (pos < archive->size) {
+        uint64_t length = 1 + (uint64_t)archive->data[pos];
+        if (pos + length > archive->size) {
+            break;
+        }
+        if (!push_offset(archive, capacity, pos)) {
+            return 0;
+        }
+        pos = pos + length;
+    }
+    return 1;
+}
+
+// Load the sidecar index. Returns the archive size it covers, or 0 if it is
+// missing/stale, in which case the archive has to be scanned from the start.
+static uint64_t load_index(GameArchive *archive, size_t *capacity, const char *path) {
+    unsigned char header[INDEX_HEADER_SIZE];
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, INDEX_MAGIC, 4) != 0 || header[4] != ARCHIVE_VERSION) {
+        fclose(file);
+        return 0;
+    }
+
+    uint64_t covered = get_u64(header + 8);
+    uint64_t count = get_u64(header + 16);
+    if (covered < ARCHIVE_HEADER_SIZE || covered > archive->size ||
+        count > (covered - ARCHIVE_HEADER_SIZE)) {
+        fclose(file);
+        return 0;
+    }
+
+    unsigned char entry[8];
+    uint64_t expected = ARCHIVE_HEADER_SIZE;
+    for (uint64_t i = 0; i < count; i++) {
+        if (fread(entry, 1, sizeof(entry), file) != sizeof(entry)) {
+            fclose(file);
+            archive->game_count = 0;
+            return 0;
+        }
+        uint64_t offset = get_u64(entry);
+        // Records are contiguous, so each offset must follow the previous one
+        if (offset != expected || offset >= covered || !push_offset(archive, capacity, offset)) {
+            fclose(file);
+            archive->game_count = 0;
+            return 0;
+        }
+        expected = offset + 1 + archive->data[offset];
+    }
+    fclose(file);
+
+    if (expected != covered) {
+        archive->game_count = 0;
+        return 0;
+    }
+    return covered;
+}
+
+int archive_write_index(const GameArchive *archive, const char *filename) {
+    unsigned char header[INDEX_HEADER_SIZE] = {0};
+    unsigned char entry[8];
+    uint64_t covered = ARCHIVE_HEADER_SIZE;
+
+    if (archive == NULL || archive->data == NULL) {
+        return 0;
+    }
+
+    if (archive->game_count > 0) {
+        uint64_t last = archive->offsets[archive->game_count - 1];
+        covered = last + 1 + archive->data[last];
+    }
+
+    memcpy(header, INDEX_MAGIC, 4);
+    header[4] = ARCHIVE_VERSION;
+    put_u64(header + 8, covered);
+    put_u64(header + 16, archive->game_count);
+
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    for (size_t i = 0; ok && i < archive->game_count; i++) {
+        put_u64(entry, archive->offsets[i]);
+        ok = fwrite(entry, 1, sizeof(entry), file) == sizeof(entry);
+    }
+
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
+
+int archive_open(GameArchive *archive, const char *filename) {
+    struct stat st;
+    size_t capacity = 0;
+
+    if (archive == NULL || filename == NULL) {
+        return 0;
+    }
+
+    archive->data = NULL;
+    archive->size = 0;
+    archive->offsets = NULL;
+    archive->game_count = 0;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < ARCHIVE_HEADER_SIZE) {
+        close(fd);
+        return 0;
+    }
+
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        return 0;
+    }
+
+#ifdef MADV_RANDOM
+    // Lookups jump around the file, readahead would only waste page cache
+    madvise(mapping, (size_t)st.st_size, MADV_RANDOM);
+#endif
+
+    archive->data = (const unsigned char *)mapping;
+    archive->size = (size_t)st.st_size;
+
+    if (!read_header(archive->data, &archive->config)) {
+        archive_close(archive);
+        return 0;
+    }
+
+    char *idx_path = index_path(filename);
+    uint64_t covered = 0;
+    if (idx_path != NULL) {
+        covered = load_index(archive, &capacity, idx_path);
+    }
+
+    // Index only needs to be extended for games appended after it was written
+    uint64_t scan_from = (covered > 0) ? covered : ARCHIVE_HEADER_SIZE;
+    if (!scan_records(archive, &capacity, scan_from)) {
+        free(idx_path);
+        archive_close(archive);
+        return 0;
+    }
+
+    if (idx_path != NULL && scan_from < archive->size) {
+        // Best effort, a read-only directory just means we rescan next time
+        archive_write_index(archive, idx_path);
+    }
+    free(idx_path);
+
+    return 1;
+}
+
+void archive_close(GameArchive *archive) {
+    if (archive == NULL) {
+        return;
+    }
+
+    if (archive->data != NULL) {
+        munmap((void *)archive->data, archive->size);
+        archive->data = NULL;
+    }
+
+    free(archive->offsets);
+    archive->offsets = NULL;
+    archive->size = 0;
+    archive->game_count = 0;
+}
+
+size_t archive_game_count(const GameArchive *archive) {
+    if (archive == NULL) {
+        return 0;
+    }
+    return archive->game_count;
+}
+
+int archive_game_length(const GameArchive *archive, size_t index) {
+    if (archive == NULL || index >= archive->game_count) {
+        return -1;
+    }
+    return archive->data[archive->offsets[index]];
+}
+
+// Apply record moves to `board`, optionally collecting them into a history list
+static int apply_record(const GameArchive *archive, size_t index, Board *board, Move **head) {
+    if (archive == NULL || board == NULL || index >= archive->game_count) {
+        return 0;
+    }
+
+    const unsigned char *record = archive->data + archive->offsets[index];
+    int count = record[0];
+
+    board_init_config(board, &archive->config);
+
+    for (int i = 0; i < count; i++) {
+        int col = record[1 + i] & 0x0F;
+        CellState player = (CellState)(record[1 + i] >> 4);
+
+        if (player != PLAYER1 && player != PLAYER2) {
+            return 0;
+        }
+
+        int row = board_drop_piece(board, col, player);
+        if (row < 0) {
+            return 0;
+        }
+
+        if (head != NULL) {
+            history_add_move(head, row, col, player);
+        }
+    }
+    return 1;
+}
+
+int archive_replay(const GameArchive *archive, size_t index, Board *board) {
+    return apply_record(archive, index, board, NULL);
+}
+
+int archive_load_moves(const GameArchive *archive, size_t index, Move **head) {
+    Board board;
+
+    if (head == NULL) {
+        return 0;
+    }
+
+    *head = NULL;
+    if (!apply_record(archive, index, &board, head)) {
+        history_free(head);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,141 @@
+#include "arena.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static unsigned char *block_data(ArenaBlock *block) {
+    return (unsigned char *)block + HEADER_SIZE;
+}
+
+static size_t align_up(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena *arena, size_t block_size) {
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->first;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+}
+
+// A new empty block linked in right after the current one
+static ArenaBlock *add_block(Arena *arena, size_t size) {
+    size_t usable = size > arena->block_size ? size : arena->block_size;
+    ArenaBlock *block = (ArenaBlock *)malloc(HEADER_SIZE + usable);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = usable;
+    block->used = 0;
+
+    if (arena->current == NULL) {
+        block->next = arena->first;
+        arena->first = block;
+    } else {
+        block->next = arena->current->next;
+        arena->current->next = block;
+    }
+    arena->current = block;
+    return block;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size ? size : 1);
+
+    ArenaBlock *block = arena->current;
+    if (block == NULL && arena->first != NULL && arena->first->size >= size) {
+        block = arena->first;
+        arena->current = block;
+    }
+    if (block == NULL || block->size - block->used < size) {
+        // the next block is empty, take it if the request fits
+        if (block != NULL && block->next != NULL && block->next->size >= size) {
+            block = block->next;
+            arena->current = block;
+        } else {
+            block = add_block(arena, size);
+            if (block == NULL) {
+                return NULL;
+            }
+        }
+    }
+
+    void *memory = block_data(block) + block->used;
+    block->used = block->used + size;
+    return memory;
+}
+
+ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = {arena->current, arena->current ? arena->current->used : 0};
+    return mark;
+}
+
+void arena_rewind(Arena *arena, ArenaMark mark) {
+    ArenaBlock *block = (mark.block != NULL) ? mark.block->next : arena->first;
+    for (; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    if (mark.block != NULL) {
+        mark.block->used = mark.used;
+    }
+    arena->current = mark.block;
+}
+
+void arena_reset(Arena *arena) {
+    for (ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        block->used = 0;
+    }
+    arena->current = NULL;
+}
+
+size_t arena_capacity(const Arena *arena) {
+    size_t total = 0;
+    for (const ArenaBlock *block = arena->first; block != NULL; block = block->next) {
+        total = total + block->size;
+    }
+    return total;
+}
+
+/* per-thread arenas */
+
+static pthread_key_t thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+static void destroy_thread_arena(void *arena) {
+    arena_free((Arena *)arena);
+    free(arena);
+}
+
+static void create_thread_key(void) {
+    pthread_key_create(&thread_key, destroy_thread_arena);
+}
+
+Arena *arena_thread(void) {
+    pthread_once(&thread_key_once, create_thread_key);
+
+    Arena *arena = (Arena *)pthread_getspecific(thread_key);
+    if (arena == NULL) {
+        arena = (Arena *)malloc(sizeof(Arena));
+        if (arena == NULL) {
+            return NULL;
+        }
+        arena_init(arena, ARENA_DEFAULT_BLOCK_SIZE);
+        if (pthread_setspecific(thread_key, arena) != 0) {
+            free(arena);
+            return NULL;
+        }
+    }
+    return arena;
+}
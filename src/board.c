@@ -1,21 +1,272 @@
 #include "board.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
+
+const BoardConfig BOARD_STANDARD = {ROWS, COLS, CONNECT};
+
+#if defined(__GNUC__)
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE static inline
+#endif
+
+/*
+ * Bitboard kernels. A line in direction `shift` (bits between neighbouring
+ * cells) that starts at bit b covers b, b + shift, ... b + (connect - 1) * shift.
+ * There is no sentinel row, so only starts whose whole line stays on the board
+ * count; start_mask() holds them for each direction.
+ *
+ * The bodies below take the geometry as arguments. The instances made with
+ * DEFINE_KERNEL pass constants, which turns every shift and mask into an
+ * immediate and unrolls the loops; the generic kernel passes the board's values.
+ */
+
+enum { DIR_HORIZONTAL, DIR_VERTICAL, DIR_UP_RIGHT, DIR_DOWN_RIGHT, DIR_COUNT };
+
+KERNEL_INLINE int direction_shift(int direction, const int rows) {
+    switch (direction) {
+        case DIR_HORIZONTAL: return rows;
+        case DIR_VERTICAL:   return 1;
+        case DIR_UP_RIGHT:   return rows + 1;
+        default:             return rows - 1;
+    }
+}
+
+// Heights low..high of columns first..last
+KERNEL_INLINE Bitboard cell_range(const int rows, int first, int last, int low, int high) {
+    Bitboard column = ((((Bitboard)1 << (high - low + 1)) - 1) << low);
+    Bitboard mask = 0;
+    for (int col = first; col <= last; col++) {
+        mask |= column << (col * rows);
+    }
+    return mask;
+}
+
+KERNEL_INLINE Bitboard start_mask(int direction, const int rows, const int cols, const int connect) {
+    switch (direction) {
+        case DIR_HORIZONTAL: return cell_range(rows, 0, cols - connect, 0, rows - 1);
+        case DIR_VERTICAL:   return cell_range(rows, 0, cols - 1, 0, rows - connect);
+        case DIR_UP_RIGHT:   return cell_range(rows, 0, cols - connect, 0, rows - connect);
+        default:             return cell_range(rows, 0, cols - connect, connect - 1, rows - 1);
+    }
+}
+
+KERNEL_INLINE int has_line_body(Bitboard stones, const int rows, const int cols, const int connect) {
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        const int shift = direction_shift(direction, rows);
+        Bitboard run = stones & start_mask(direction, rows, cols, connect);
+        for (int k = 1; k < connect; k++) {
+            run &= stones >> (k * shift);
+        }
+        if (run) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// For every position j of the missing stone within a line: the starts whose
+// other connect - 1 cells are all set, moved onto the missing cell.
+KERNEL_INLINE Bitboard threats_body(Bitboard stones, const int rows, const int cols, const int connect) {
+    Bitboard threats = 0;
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        const int shift = direction_shift(direction, rows);
+        const Bitboard starts = start_mask(direction, rows, cols, connect);
+        for (int j = 0; j < connect; j++) {
+            Bitboard run = starts;
+            for (int k = 0; k < connect; k++) {
+                if (k != j) {
+                    run &= stones >> (k * shift);
+                }
+            }
+            threats |= run << (j * shift);
+        }
+    }
+    return threats;
+}
+
+// Counts the stones of the windows starting at every bit at once, bit-sliced:
+// bit b of slice[j] is bit j of the count of the window that starts at b.
+// After k + 1 cells a count fits in the slices j with 2^j <= k + 1.
+KERNEL_INLINE void window_counts_body(Bitboard stones, int counts[3], const int rows, const int cols,
+                                      const int connect) {
+    counts[0] = counts[1] = counts[2] = 0;
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        const int shift = direction_shift(direction, rows);
+        Bitboard slice[4] = {0, 0, 0, 0};
+        for (int k = 0; k < connect; k++) {
+            Bitboard carry = stones >> (k * shift);
+            for (int j = 0; (1 << j) <= k + 1; j++) {
+                Bitboard next = slice[j] & carry;
+                slice[j] ^= carry;
+                carry = next;
+            }
+        }
+        for (int i = 0; i < 3; i++) {
+            const int count = connect - i;
+            Bitboard equal = start_mask(direction, rows, cols, connect);
+            for (int j = 0; j < 4; j++) {
+                equal &= ((count >> j) & 1) ? slice[j] : ~slice[j];
+            }
+            counts[i] += __builtin_popcountll(equal);
+        }
+    }
+}
+
+KERNEL_INLINE Bitboard playable_body(Bitboard occupied, const int rows, const int cols) {
+    const Bitboard bottom = cell_range(rows, 0, cols - 1, 0, 0);
+    const Bitboard all = cell_range(rows, 0, cols - 1, 0, rows - 1);
+    // the cell above each stone, or the bottom; a full column's top moves onto
+    // the next column's bottom, which `bottom` covers anyway
+    return ((occupied << 1) | bottom) & ~occupied & all;
+}
+
+#define DEFINE_KERNEL(name, rows, cols, connect)                                           \
+    static int name##_has_line(const Board *board, Bitboard stones) {                      \
+        (void)board;                                                                       \
+        return has_line_body(stones, rows, cols, connect);                                 \
+    }                                                                                      \
+    static Bitboard name##_threats(const Board *board, Bitboard stones) {                  \
+        (void)board;                                                                       \
+        return threats_body(stones, rows, cols, connect);                                  \
+    }                                                                                      \
+    static Bitboard name##_playable(const Board *board, Bitboard occupied) {               \
+        (void)board;                                                                       \
+        return playable_body(occupied, rows, cols);                                        \
+    }                                                                                      \
+    static void name##_window_counts(const Board *board, Bitboard stones, int counts[3]) { \
+        (void)board;                                                                       \
+        window_counts_body(stones, counts, rows, cols, connect);                           \
+    }                                                                                      \
+    static const BoardKernel name = {name##_has_line, name##_threats, name##_playable,     \
+                                     name##_window_counts};
+
+DEFINE_KERNEL(kernel_7x6, 6, 7, 4)
+DEFINE_KERNEL(kernel_8x7, 7, 8, 4)
+DEFINE_KERNEL(kernel_9x7, 7, 9, 4)
+DEFINE_KERNEL(kernel_9x6_5, 6, 9, 5)
+
+static int generic_has_line(const Board *board, Bitboard stones) {
+    return has_line_body(stones, board->rows, board->cols, board->connect);
+}
+
+static Bitboard generic_threats(const Board *board, Bitboard stones) {
+    return threats_body(stones, board->rows, board->cols, board->connect);
+}
+
+static Bitboard generic_playable(const Board *board, Bitboard occupied) {
+    return playable_body(occupied, board->rows, board->cols);
+}
+
+static void generic_window_counts(const Board *board, Bitboard stones, int counts[3]) {
+    window_counts_body(stones, counts, board->rows, board->cols, board->connect);
+}
+
+static const BoardKernel kernel_generic = {generic_has_line, generic_threats, generic_playable,
+                                           generic_window_counts};
+
+static const struct {
+    BoardConfig config;
+    const BoardKernel *kernel;
+} KERNELS[] = {
+    {{6, 7, 4}, &kernel_7x6},
+    {{7, 8, 4}, &kernel_8x7},
+    {{7, 9, 4}, &kernel_9x7},
+    {{6, 9, 5}, &kernel_9x6_5},
+};
+
+static const BoardKernel *select_kernel(const BoardConfig *config) {
+    for (size_t i = 0; i < sizeof(KERNELS) / sizeof(KERNELS[0]); i++) {
+        const BoardConfig *known = &KERNELS[i].config;
+        if (known->rows == config->rows && known->cols == config->cols &&
+            known->connect == config->connect) {
+            return KERNELS[i].kernel;
+        }
+    }
+    return &kernel_generic;
+}
+
+int board_config_valid(const BoardConfig *config) {
+    if (config == NULL) {
+        return 0;
+    }
+    if (config->rows < 4 || config->rows > MAX_ROWS ||
+        config->cols < 4 || config->cols > MAX_COLS ||
+        config->rows * config->cols > MAX_CELLS) {
+        return 0;
+    }
+    return config->connect >= 4 && config->connect <= config->rows &&
+           config->connect <= config->cols;
+}
+
+int board_config_parse(const char *text, BoardConfig *config) {
+    BoardConfig parsed = {0, 0, CONNECT};
+    int used = 0;
+
+    if (text == NULL || config == NULL) {
+        return 0;
+    }
+
+    if (sscanf(text, "%dx%d%n", &parsed.cols, &parsed.rows, &used) != 2) {
+        return 0;
+    }
+    if (text[used] == ':') {
+        int more = 0;
+        if (sscanf(text + used + 1, "%d%n", &parsed.connect, &more) != 1) {
+            return 0;
+        }
+        used = used + 1 + more;
+    }
+    if (text[used] != '\0' || !board_config_valid(&parsed)) {
+        return 0;
+    }
+
+    *config = parsed;
+    return 1;
+}
 
 void board_init(Board *board) {
+    board_init_config(board, &BOARD_STANDARD);
+}
+
+int board_init_config(Board *board, const BoardConfig *config) {
+    int valid = board_config_valid(config);
+    if (!valid) {
+        config = &BOARD_STANDARD;
+    }
+
+    // Padding included, so boards of equal positions compare equal with memcmp
+    memset(board, 0, sizeof(*board));
+    board->rows = config->rows;
+    board->cols = config->cols;
+    board->connect = config->connect;
+    board->kernel = select_kernel(config);
+    return valid;
+}
+
+void board_clear(Board *board) {
     // Set all cells to EMPTY (value 0)
     memset(board->cells, EMPTY, sizeof(board->cells));
+    board->stones[0] = 0;
+    board->stones[1] = 0;
+}
+
+BoardConfig board_config(const Board *board) {
+    BoardConfig config = {board->rows, board->cols, board->connect};
+    return config;
 }
 
 int board_drop_piece(Board *board, int col, CellState player) {
-    // Check if column number is valid (0-6)
-    if (col < 0 || col >= COLS) {
+    // Check if column number is valid (0 to cols - 1)
+    if (col < 0 || col >= board->cols || (player != PLAYER1 && player != PLAYER2)) {
         return -1;
     }
 
-    for (int row = ROWS - 1; row >= 0; row--) {
+    for (int row = board->rows - 1; row >= 0; row--) {
         if (board->cells[row][col] == EMPTY) {
-            board->cells[row][col] = player;  
+            board->cells[row][col] = (unsigned char)player;
+            board->stones[player - PLAYER1] |= board_cell_bit(board, row, col);
             return row;
         }
     }
@@ -23,9 +274,40 @@ int board_drop_piece(Board *board, int col, CellState player) {
     return -1;
 }
 
+Bitboard board_cell_bit(const Board *board, int row, int col) {
+    return (Bitboard)1 << (col * board->rows + (board->rows - 1 - row));
+}
+
+Bitboard board_column_cells(const Board *board, int col) {
+    return (((Bitboard)1 << board->rows) - 1) << (col * board->rows);
+}
+
+void board_set_cell(Board *board, int row, int col, CellState state) {
+    Bitboard bit = board_cell_bit(board, row, col);
+
+    board->cells[row][col] = (unsigned char)state;
+    board->stones[0] &= ~bit;
+    board->stones[1] &= ~bit;
+    if (state == PLAYER1 || state == PLAYER2) {
+        board->stones[state - PLAYER1] |= bit;
+    }
+}
+
+Bitboard board_winning_cells(const Board *board, CellState player) {
+    if (player != PLAYER1 && player != PLAYER2) {
+        return 0;
+    }
+    Bitboard occupied = board->stones[0] | board->stones[1];
+    return board->kernel->threats(board, board->stones[player - PLAYER1]) & ~occupied;
+}
+
+Bitboard board_playable_cells(const Board *board) {
+    return board->kernel->playable(board, board->stones[0] | board->stones[1]);
+}
+
 int board_is_valid_move(const Board *board, int col) {
     // Check column number is in range
-    if (col < 0 || col >= COLS) {
+    if (col < 0 || col >= board->cols) {
         return 0;
     }
 
@@ -34,7 +316,7 @@ int board_is_valid_move(const Board *board, int col) {
 
 int board_is_full(const Board *board) {
     // Check each column's top row
-    for (int col = 0; col < COLS; col++) {
+    for (int col = 0; col < board->cols; col++) {
         if (board->cells[0][col] == EMPTY) {
             return 0;
         }
@@ -44,12 +326,18 @@ int board_is_full(const Board *board) {
 
 void board_print(const Board *board) {
     printf("\n");
-    printf(" 0 1 2 3 4 5 6\n");
-    printf(" =============\n");
+    for (int col = 0; col < board->cols; col++) {
+        printf(" %d", col);
+    }
+    printf("\n ");
+    for (int col = 0; col < 2 * board->cols - 1; col++) {
+        printf("=");
+    }
+    printf("\n");
 
-    for (int row = 0; row < ROWS; row++) {
+    for (int row = 0; row < board->rows; row++) {
         printf("|");
-        for (int col = 0; col < COLS; col++) {
+        for (int col = 0; col < board->cols; col++) {
             if (board->cells[row][col] == EMPTY) {
                 printf(" ");
             } else if (board->cells[row][col] == PLAYER1) {
@@ -64,55 +352,10 @@ void board_print(const Board *board) {
 }
 
 int board_check_winner(const Board *board, CellState player) {
-    // Check rows
-    for (int row = 0; row < ROWS; row++) {
-        for (int col = 0; col <= COLS - 4; col++) {
-            if (board->cells[row][col] == player &&
-                board->cells[row][col + 1] == player &&
-                board->cells[row][col + 2] == player &&
-                board->cells[row][col + 3] == player) {
-                return 1;  // win
-            }
-        }
-    }
-    
-    // Check cols
-    for (int row = 0; row <= ROWS - 4; row++) {
-        for (int col = 0; col < COLS; col++) {
-            if (board->cells[row][col] == player &&
-                board->cells[row + 1][col] == player &&
-                board->cells[row + 2][col] == player &&
-                board->cells[row + 3][col] == player) {
-                return 1; 
-            }
-        }
-    }
-    
-    // Check diagonal going down-right
-    for (int row = 0; row <= ROWS - 4; row++) {
-        for (int col = 0; col <= COLS - 4; col++) {
-            if (board->cells[row][col] == player &&
-                board->cells[row + 1][col + 1] == player &&
-                board->cells[row + 2][col + 2] == player &&
-                board->cells[row + 3][col + 3] == player) {
-                return 1;
-            }
-        }
-    }
-    
-    // Check diagonal going down-left
-    for (int row = 0; row <= ROWS - 4; row++) {
-        for (int col = 3; col < COLS; col++) {
-            if (board->cells[row][col] == player &&
-                board->cells[row + 1][col - 1] == player &&
-                board->cells[row + 2][col - 2] == player &&
-                board->cells[row + 3][col - 3] == player) {
-                return 1; 
-            }
-        }
+    if (player != PLAYER1 && player != PLAYER2) {
+        return 0;
     }
-    
-    return 0;
+    return board->kernel->has_line(board, board->stones[player - PLAYER1]);
 }
 
 int board_check_draw(const Board *board) {
@@ -128,3 +371,326 @@ int board_check_draw(const Board *board) {
     
     return 1; 
 }
+
+int board_play_moves(Board *board, const char *moves, CellState *next_player) {
+    return board_play_moves_config(board, &BOARD_STANDARD, moves, next_player);
+}
+
+int board_play_moves_config(Board *board, const BoardConfig *config, const char *moves,
+                            CellState *next_player) {
+    CellState player = PLAYER1;
+    int count = 0;
+
+    if (!board_init_config(board, config)) {
+        return -1;
+    }
+
+    for (const char *p = moves; *p != '\0'; p++) {
+        int col = *p - '1';
+        if (col < 0 || col >= board->cols) {
+            return -1;
+        }
+        // Positions past the end of a finished game are not meaningful
+        if (count > 0 && board_check_winner(board, player == PLAYER1 ? PLAYER2 : PLAYER1)) {
+            return -1;
+        }
+        if (board_drop_piece(board, col, player) < 0) {
+            return -1;
+        }
+        player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+        count++;
+    }
+
+    if (next_player != NULL) {
+        *next_player = player;
+    }
+    return count;
+}
+
+// Plays and takes back moves in place, every child is checked with the full
+// board_check_winner so perft exercises the same code paths as the game.
+static unsigned long long perft_recursive(Board *board, CellState player, int depth) {
+    CellState next = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    unsigned long long leaves = 0;
+    int moved = 0;
+
+    for (int col = 0; col < board->cols; col++) {
+        int row = board_drop_piece(board, col, player);
+        if (row < 0) {
+            continue;
+        }
+        moved = 1;
+
+        if (depth == 1 || board_check_winner(board, player)) {
+            leaves = leaves + 1;
+        } else {
+            leaves = leaves + perft_recursive(board, next, depth - 1);
+        }
+
+        board_set_cell(board, row, col, EMPTY);
+    }
+
+    // Full board: the game ended in a draw
+    if (!moved) {
+        return 1;
+    }
+    return leaves;
+}
+
+unsigned long long board_perft(const Board *board, CellState player, int depth) {
+    if (depth <= 0) {
+        return 1;
+    }
+
+    Board scratch = *board;
+    return perft_recursive(&scratch, player, depth);
+}
+
+/*
+ * Batches. Every board of a batch has the same geometry, so each lane of a
+ * vector register runs the same shifts and masks: SSE2 checks two bitboards
+ * per instruction, AVX2 four. The widest unit the CPU has is picked on first
+ * use; anything left over, and CPUs without either, go through the scalar kernel.
+ */
+
+typedef struct {
+    int shift[DIR_COUNT];
+    Bitboard starts[DIR_COUNT];
+    int connect;
+} LineMasks;
+
+typedef void (*HasLineBatchFn)(const Board *board, const LineMasks *masks, const Bitboard *stones,
+                               int count, unsigned char *out);
+
+static void line_masks(const Board *board, LineMasks *masks) {
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        masks->shift[direction] = direction_shift(direction, board->rows);
+        masks->starts[direction] = start_mask(direction, board->rows, board->cols, board->connect);
+    }
+    masks->connect = board->connect;
+}
+
+static void has_line_batch_scalar(const Board *board, const LineMasks *masks, const Bitboard *stones,
+                                  int count, unsigned char *out) {
+    (void)masks;
+    for (int i = 0; i < count; i++) {
+        out[i] = (unsigned char)(board->kernel->has_line(board, stones[i]) != 0);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_BATCH_VECTORS 1
+
+/*
+ * Four in a row takes two shifts per direction: pairs of stones, then pairs of
+ * pairs. The masks and shift counts stay in registers across the loop; other
+ * line lengths shift once per stone.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128i four_sse2(__m128i cells, __m128i one, __m128i two, __m128i starts) {
+    __m128i run = _mm_and_si128(cells, _mm_srl_epi64(cells, one));
+    run = _mm_and_si128(run, _mm_srl_epi64(run, two));
+    return _mm_and_si128(run, starts);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i any_line_sse2(__m128i cells, const LineMasks *masks) {
+    __m128i any = _mm_setzero_si128();
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        __m128i run = cells;
+        for (int k = 1; k < masks->connect; k++) {
+            run = _mm_and_si128(run, _mm_srl_epi64(cells, _mm_cvtsi32_si128(k * masks->shift[direction])));
+        }
+        any = _mm_or_si128(any, _mm_and_si128(run, _mm_set1_epi64x((long long)masks->starts[direction])));
+    }
+    return any;
+}
+
+__attribute__((target("sse2")))
+static void has_line_batch_sse2(const Board *board, const LineMasks *masks, const Bitboard *stones,
+                                int count, unsigned char *out) {
+    const __m128i one0 = _mm_cvtsi32_si128(masks->shift[0]), two0 = _mm_cvtsi32_si128(2 * masks->shift[0]);
+    const __m128i one1 = _mm_cvtsi32_si128(masks->shift[1]), two1 = _mm_cvtsi32_si128(2 * masks->shift[1]);
+    const __m128i one2 = _mm_cvtsi32_si128(masks->shift[2]), two2 = _mm_cvtsi32_si128(2 * masks->shift[2]);
+    const __m128i one3 = _mm_cvtsi32_si128(masks->shift[3]), two3 = _mm_cvtsi32_si128(2 * masks->shift[3]);
+    const __m128i starts0 = _mm_set1_epi64x((long long)masks->starts[0]);
+    const __m128i starts1 = _mm_set1_epi64x((long long)masks->starts[1]);
+    const __m128i starts2 = _mm_set1_epi64x((long long)masks->starts[2]);
+    const __m128i starts3 = _mm_set1_epi64x((long long)masks->starts[3]);
+    const int four = masks->connect == 4;
+    int i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        __m128i cells = _mm_loadu_si128((const __m128i *)(stones + i));
+        __m128i any;
+        if (four) {
+            any = _mm_or_si128(_mm_or_si128(four_sse2(cells, one0, two0, starts0), four_sse2(cells, one1, two1, starts1)),
+                               _mm_or_si128(four_sse2(cells, one2, two2, starts2), four_sse2(cells, one3, two3, starts3)));
+        } else {
+            any = any_line_sse2(cells, masks);
+        }
+        // a lane without a line compares equal to zero in both halves
+        int empty = _mm_movemask_epi8(_mm_cmpeq_epi32(any, _mm_setzero_si128()));
+        out[i] = (unsigned char)((empty & 0x00ff) != 0x00ff);
+        out[i + 1] = (unsigned char)((empty & 0xff00) != 0xff00);
+    }
+    has_line_batch_scalar(board, masks, stones + i, count - i, out + i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i four_avx2(__m256i cells, __m128i one, __m128i two, __m256i starts) {
+    __m256i run = _mm256_and_si256(cells, _mm256_srl_epi64(cells, one));
+    run = _mm256_and_si256(run, _mm256_srl_epi64(run, two));
+    return _mm256_and_si256(run, starts);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i any_line_avx2(__m256i cells, const LineMasks *masks) {
+    __m256i any = _mm256_setzero_si256();
+    for (int direction = 0; direction < DIR_COUNT; direction++) {
+        __m256i run = cells;
+        for (int k = 1; k < masks->connect; k++) {
+            run = _mm256_and_si256(run, _mm256_srl_epi64(cells, _mm_cvtsi32_si128(k * masks->shift[direction])));
+        }
+        any = _mm256_or_si256(any, _mm256_and_si256(run, _mm256_set1_epi64x((long long)masks->starts[direction])));
+    }
+    return any;
+}
+
+__attribute__((target("avx2")))
+static void has_line_batch_avx2(const Board *board, const LineMasks *masks, const Bitboard *stones,
+                                int count, unsigned char *out) {
+    const __m128i one0 = _mm_cvtsi32_si128(masks->shift[0]), two0 = _mm_cvtsi32_si128(2 * masks->shift[0]);
+    const __m128i one1 = _mm_cvtsi32_si128(masks->shift[1]), two1 = _mm_cvtsi32_si128(2 * masks->shift[1]);
+    const __m128i one2 = _mm_cvtsi32_si128(masks->shift[2]), two2 = _mm_cvtsi32_si128(2 * masks->shift[2]);
+    const __m128i one3 = _mm_cvtsi32_si128(masks->shift[3]), two3 = _mm_cvtsi32_si128(2 * masks->shift[3]);
+    const __m256i starts0 = _mm256_set1_epi64x((long long)masks->starts[0]);
+    const __m256i starts1 = _mm256_set1_epi64x((long long)masks->starts[1]);
+    const __m256i starts2 = _mm256_set1_epi64x((long long)masks->starts[2]);
+    const __m256i starts3 = _mm256_set1_epi64x((long long)masks->starts[3]);
+    const int four = masks->connect == 4;
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i cells = _mm256_loadu_si256((const __m256i *)(stones + i));
+        __m256i any;
+        if (four) {
+            any = _mm256_or_si256(
+                _mm256_or_si256(four_avx2(cells, one0, two0, starts0), four_avx2(cells, one1, two1, starts1)),
+                _mm256_or_si256(four_avx2(cells, one2, two2, starts2), four_avx2(cells, one3, two3, starts3)));
+        } else {
+            any = any_line_avx2(cells, masks);
+        }
+        // one bit per lane without a line
+        int empty = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(any, _mm256_setzero_si256())));
+        out[i] = (unsigned char)(~empty & 1);
+        out[i + 1] = (unsigned char)((~empty >> 1) & 1);
+        out[i + 2] = (unsigned char)((~empty >> 2) & 1);
+        out[i + 3] = (unsigned char)((~empty >> 3) & 1);
+    }
+    has_line_batch_sse2(board, masks, stones + i, count - i, out + i);
+}
+#endif
+
+static const struct {
+    const char *name;
+    HasLineBatchFn has_line;
+} BATCH_KERNELS[] = {
+#ifdef HAS_BATCH_VECTORS
+    {"avx2", has_line_batch_avx2},
+    {"sse2", has_line_batch_sse2},
+#endif
+    {"scalar", has_line_batch_scalar},
+};
+
+#define BATCH_KERNEL_COUNT ((int)(sizeof(BATCH_KERNELS) / sizeof(BATCH_KERNELS[0])))
+#define BATCH_CHUNK 64
+
+static atomic_int batch_kernel = -1;    // index into BATCH_KERNELS, -1 until picked
+
+static int cpu_supports(const char *name) {
+#ifdef HAS_BATCH_VECTORS
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(name, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return strcmp(name, "scalar") == 0;
+}
+
+// The first kernel of the list the CPU runs; every thread picks the same one
+static int current_batch_kernel(void) {
+    int kernel = atomic_load_explicit(&batch_kernel, memory_order_relaxed);
+    if (kernel < 0) {
+        kernel = BATCH_KERNEL_COUNT - 1;
+        for (int i = 0; i < BATCH_KERNEL_COUNT; i++) {
+            if (cpu_supports(BATCH_KERNELS[i].name)) {
+                kernel = i;
+                break;
+            }
+        }
+        atomic_store_explicit(&batch_kernel, kernel, memory_order_relaxed);
+    }
+    return kernel;
+}
+
+int board_batch_select(const char *name) {
+    for (int i = 0; i < BATCH_KERNEL_COUNT; i++) {
+        if (strcmp(BATCH_KERNELS[i].name, name) == 0 && cpu_supports(name)) {
+            atomic_store_explicit(&batch_kernel, i, memory_order_relaxed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+const char *board_batch_kernel(void) {
+    return BATCH_KERNELS[current_batch_kernel()].name;
+}
+
+void board_has_line_batch(const Board *board, const Bitboard *stones, int count, unsigned char *out) {
+    LineMasks masks;
+    line_masks(board, &masks);
+    BATCH_KERNELS[current_batch_kernel()].has_line(board, &masks, stones, count, out);
+}
+
+static int same_geometry(const Board *a, const Board *b) {
+    return a->rows == b->rows && a->cols == b->cols && a->connect == b->connect;
+}
+
+void board_check_winner_batch(const Board *boards, int count, CellState *out) {
+    Bitboard stones[2 * BATCH_CHUNK];
+    unsigned char lines[2 * BATCH_CHUNK];
+
+    if (BATCH_KERNELS[current_batch_kernel()].has_line == has_line_batch_scalar) {
+        // gathering only pays off for vectors, and the loop can stop at the first line
+        for (int i = 0; i < count; i++) {
+            out[i] = board_check_winner(&boards[i], PLAYER1) ? PLAYER1 :
+                     (board_check_winner(&boards[i], PLAYER2) ? PLAYER2 : EMPTY);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count;) {
+        // a run of boards of one geometry, both players' stones in one batch
+        int n = 1;
+        while (n < BATCH_CHUNK && i + n < count && same_geometry(&boards[i + n], &boards[i])) {
+            n++;
+        }
+        for (int j = 0; j < n; j++) {
+            stones[j] = boards[i + j].stones[0];
+            stones[n + j] = boards[i + j].stones[1];
+        }
+        board_has_line_batch(&boards[i], stones, 2 * n, lines);
+        // without branches: which player has a line is as good as random
+        for (int j = 0; j < n; j++) {
+            out[i + j] = (CellState)(lines[j] * PLAYER1 + (lines[n + j] & (lines[j] ^ 1)) * PLAYER2);
+        }
+        i = i + n;
+    }
+}
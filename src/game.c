@@ -2,15 +2,22 @@
 #include "ai.h"
 #include "board.h"
 #include "history.h"
+#include "archive.h"
 #include "io.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <ctype.h>
 #include <pthread.h>
 
 void game_init(Game *game, GameMode mode, CellState starting_player, CellState ai_player, AILevel ai_level) {
-    if (!game) return;
+    game_init_config(game, &BOARD_STANDARD, mode, starting_player, ai_player, ai_level);
+}
+
+int game_init_config(Game *game, const BoardConfig *config, GameMode mode,
+                     CellState starting_player, CellState ai_player, AILevel ai_level) {
+    if (!game) return 0;
 
-    board_init(&game->board);
+    int valid = board_init_config(&game->board, config);
 
     game->current_player = starting_player;
     game->mode = mode;
@@ -20,10 +27,18 @@ void game_init(Game *game, GameMode mode, CellState starting_player, CellState a
     game->is_over = 0;
     game->winner = EMPTY;
     game->is_draw = 0;
+    ai_ponder_init(&game->ponder);
+    rng_seed(&game->rng, RNG_DEFAULT_SEED);
+    return valid;
+}
+
+void game_seed(Game *game, uint64_t seed) {
+    rng_seed(&game->rng, seed);
 }
 
 void game_cleanup(Game *game) {
     if (!game) return;
+    ai_ponder_stop(&game->ponder);
     history_free(&game->history);
 }
 
@@ -40,18 +55,25 @@ static void switch_player(Game *game) {
 //Returns 1 on success and 0 if a bug happened (should not happen, but just in case, for debugging purposes)
 static int do_ai_move(Game *game) {
     int col;
+    SearchResult search = {.column = -1};
 
-    if (game->ai_level == AI_EASY) {
-        col = ai_easy(&game->board, game->current_player);
-    } else if (game->ai_level == AI_MEDIUM) {
-        col = ai_medium(&game->board, game->current_player);
+    if (game->ai_level == AI_EASY || game->ai_level == AI_MEDIUM) {
+        SearchContext context;
+        ai_context_init(&context);
+        context.rng = &game->rng;
+        col = ai_search_context(&game->board, game->current_player, game->ai_level, &context, &search);
     } else {
         AIThread task;
+        SearchContext context;
         pthread_t thread;
 
         task.board_copy = game->board;
         task.ai_player = game->current_player;
         task.ai_level = game->ai_level;
+        task.context = &context;
+        ai_context_init(&context);
+        ai_context_from_env(&context);
+        context.rng = &game->rng;
         task.result = -1;
 
         if (pthread_create(&thread, NULL, ai_thread_function, &task) != 0) {
@@ -60,10 +82,17 @@ static int do_ai_move(Game *game) {
         } else {
             pthread_join(thread, NULL);
             col = task.result;
+            search.stats = task.stats;
         }
     }
 
-    if (col < 0 || col >= COLS) {
+    // Set CONNECT4_SEARCH_STATS to log what each AI search did
+    if (getenv("CONNECT4_SEARCH_STATS") != NULL) {
+        fprintf(stderr, "[search] ");
+        ai_print_stats(stderr, &search.stats);
+    }
+
+    if (col < 0 || col >= game->board.cols) {
         fprintf(stderr, "AI chose invalid column %d.\n", col);
         return 0;
     }
@@ -87,7 +116,7 @@ static int do_ai_move(Game *game) {
 //does one player move, but keep in mind that if it plays against another person, i disabled undo so no one copmplains about "unfairness"
 static int do_human_move(Game *game, int allow_undo) {
     while (1) {
-        int res = prompt_human_move(allow_undo);
+        int res = prompt_human_move(game->board.cols, allow_undo);
 
         if (res == -1) {
             game->is_over = 1;
@@ -151,7 +180,11 @@ void game_run(Game *game) {
             move_ok = do_ai_move(game);
         } else {
             int allow_undo = (game->mode == GAME_MODE_PVAI);
+            if (game->mode == GAME_MODE_PVAI) {
+                ai_ponder_start(&game->ponder, &game->board, game->ai_player, game->ai_level);
+            }
             move_ok = do_human_move(game, allow_undo);
+            ai_ponder_stop(&game->ponder);
         }
 
         if (!move_ok) {
@@ -188,5 +221,9 @@ void game_run(Game *game) {
         printf("Game ended.\n");
     }
     history_print(game->history, "game_history.txt");
+    if (game->winner != EMPTY || game->is_draw) {
+        BoardConfig config = board_config(&game->board);
+        archive_append_game("game_archive.c4a", &config, game->history);
+    }
     printf("\n");
 }
\ No newline at end of file
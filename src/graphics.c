@@ -1,6 +1,6 @@
 #include "graphics.h"
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
 
 static const SDL_Color COLOR_BACKGROUND = {40, 44, 52, 255};
 static const SDL_Color COLOR_BOARD = {33, 100, 209, 255};
@@ -11,13 +11,106 @@ static const SDL_Color COLOR_HOVER = {80, 90, 110, 255};
 static const SDL_Color COLOR_TEXT_BG = {50, 55, 65, 255};
 static const SDL_Color COLOR_WHITE = {255, 255, 255, 255};
 
-int graphics_init(Graphics *gfx, const char *title) {
-    if (!gfx) return -1;
+#define DISC_RADIUS (CELL_SIZE / 2 - 6)
+#define HOVER_RADIUS (CELL_SIZE / 2 - 10)
+#define HIGHLIGHT_RADIUS (CELL_SIZE / 2 - 2)
+
+#define DROP_SECONDS 0.35        // Time a disc takes to fall the full column
+#define HIGHLIGHT_SECONDS 0.4    // Fade-in time of the win line highlight
+#define MAX_FRAME_SECONDS 0.25   // Longer gaps (window dragged, breakpoint) are clamped
+
+static void destroy_disc_textures(Graphics *gfx) {
+    for (int i = 0; i < DISC_COUNT; i++) {
+        if (gfx->discs[i]) {
+            SDL_DestroyTexture(gfx->discs[i]);
+            gfx->discs[i] = NULL;
+        }
+    }
+}
+
+// Filled disc of the given color on a transparent square, 2 * radius + 1 wide.
+// Same pixels the old per-frame scanline fill produced.
+static SDL_Texture *create_disc_texture(SDL_Renderer *renderer, SDL_Color color, int radius) {
+    int size = 2 * radius + 1;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_RGBA32);
+    if (!surface) {
+        return NULL;
+    }
+
+    Uint32 inside = SDL_MapRGBA(surface->format, color.r, color.g, color.b, color.a);
+    Uint32 outside = SDL_MapRGBA(surface->format, 0, 0, 0, 0);
+
+    SDL_LockSurface(surface);
+    for (int y = 0; y < size; y++) {
+        Uint32 *pixels = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        int dy = y - radius;
+        for (int x = 0; x < size; x++) {
+            int dx = x - radius;
+            pixels[x] = (dx * dx + dy * dy <= radius * radius) ? inside : outside;
+        }
+    }
+    SDL_UnlockSurface(surface);
+
+    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (texture) {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+    return texture;
+}
+
+static int create_disc_textures(Graphics *gfx) {
+    gfx->discs[DISC_EMPTY] = create_disc_texture(gfx->renderer, COLOR_EMPTY, DISC_RADIUS);
+    gfx->discs[DISC_PLAYER1] = create_disc_texture(gfx->renderer, COLOR_PLAYER1, DISC_RADIUS);
+    gfx->discs[DISC_PLAYER2] = create_disc_texture(gfx->renderer, COLOR_PLAYER2, DISC_RADIUS);
+    gfx->discs[DISC_HOVER_PLAYER1] = create_disc_texture(gfx->renderer, COLOR_PLAYER1, HOVER_RADIUS);
+    gfx->discs[DISC_HOVER_PLAYER2] = create_disc_texture(gfx->renderer, COLOR_PLAYER2, HOVER_RADIUS);
+    gfx->discs[DISC_HIGHLIGHT] = create_disc_texture(gfx->renderer, COLOR_WHITE, HIGHLIGHT_RADIUS);
+
+    for (int i = 0; i < DISC_COUNT; i++) {
+        if (!gfx->discs[i]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void reset_state(Graphics *gfx, const BoardConfig *config) {
+    if (config == NULL) {
+        config = &BOARD_STANDARD;
+    }
     
     gfx->window = NULL;
     gfx->renderer = NULL;
+    gfx->surface = NULL;
+    for (int i = 0; i < DISC_COUNT; i++) {
+        gfx->discs[i] = NULL;
+    }
+    gfx->rows = config->rows;
+    gfx->cols = config->cols;
     gfx->running = 1;
     gfx->selected_column = -1;
+    gfx->dirty = 1;
+    
+    gfx->drop.active = 0;
+    gfx->highlight = 1.0;
+    gfx->previous_highlight = 1.0;
+    
+    gfx->clock.last_update = 0;
+    gfx->clock.accumulator = 0.0;
+    gfx->clock.alpha = 0.0;
+    gfx->clock.last_frame = 0;
+    
+    gfx->log.count = 0;
+    gfx->log.input_time = 0;
+    gfx->log.latency_pending = 0;
+    gfx->show_overlay = 0;
+}
+
+int graphics_init(Graphics *gfx, const char *title, const BoardConfig *config) {
+    if (!gfx) return -1;
+    
+    reset_state(gfx, config);
     
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
@@ -28,8 +121,8 @@ int graphics_init(Graphics *gfx, const char *title) {
         title,
         SDL_WINDOWPOS_CENTERED,
         SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH,
-        WINDOW_HEIGHT,
+        WINDOW_WIDTH(gfx->cols),
+        WINDOW_HEIGHT(gfx->rows),
         SDL_WINDOW_SHOWN
     );
     
@@ -48,12 +141,198 @@ int graphics_init(Graphics *gfx, const char *title) {
         return -1;
     }
     
+    if (create_disc_textures(gfx) != 0) {
+        fprintf(stderr, "Creating disc textures failed: %s\n", SDL_GetError());
+        graphics_cleanup(gfx);
+        return -1;
+    }
+    
     return 0;
 }
 
+int graphics_init_offscreen(Graphics *gfx, const BoardConfig *config) {
+    if (!gfx) return -1;
+    
+    reset_state(gfx, config);
+    
+    // No window is ever opened; the dummy driver lets SDL_Init succeed without a display
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    
+    gfx->surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH(gfx->cols),
+                                                  WINDOW_HEIGHT(gfx->rows), 32,
+                                                  SDL_PIXELFORMAT_ARGB8888);
+    if (!gfx->surface) {
+        fprintf(stderr, "SDL_CreateRGBSurfaceWithFormat failed: %s\n", SDL_GetError());
+        graphics_cleanup(gfx);
+        return -1;
+    }
+    
+    gfx->renderer = SDL_CreateSoftwareRenderer(gfx->surface);
+    if (!gfx->renderer) {
+        fprintf(stderr, "SDL_CreateSoftwareRenderer failed: %s\n", SDL_GetError());
+        graphics_cleanup(gfx);
+        return -1;
+    }
+    
+    if (create_disc_textures(gfx) != 0) {
+        fprintf(stderr, "Creating disc textures failed: %s\n", SDL_GetError());
+        graphics_cleanup(gfx);
+        return -1;
+    }
+    
+    return 0;
+}
+
+int graphics_save_snapshot(Graphics *gfx, const char *path) {
+    // A window's back buffer is undefined after SDL_RenderPresent, so offscreen only
+    if (!gfx || !gfx->surface || !path) return -1;
+    
+    if (SDL_SaveBMP(gfx->surface, path) != 0) {
+        fprintf(stderr, "SDL_SaveBMP failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    return 0;
+}
+
+/* frame log */
+
+static unsigned long logged_frames(const FrameLog *log) {
+    return (log->count < FRAME_LOG_SIZE) ? log->count : FRAME_LOG_SIZE;
+}
+
+// i-th oldest frame still in the log
+static const FrameSample *logged_frame(const FrameLog *log, unsigned long i) {
+    unsigned long first = log->count - logged_frames(log);
+    return &log->samples[(first + i) % FRAME_LOG_SIZE];
+}
+
+static Uint32 ticks_to_us(Uint64 ticks) {
+    Uint64 us = ticks * 1000000 / SDL_GetPerformanceFrequency();
+    return (us > 0xFFFFFFFFu) ? 0xFFFFFFFFu : (Uint32)us;
+}
+
+static void print_frame_stats(const Graphics *gfx) {
+    const FrameLog *log = &gfx->log;
+    unsigned long frames = logged_frames(log);
+    Uint64 render_total = 0, present_total = 0, latency_total = 0;
+    Uint32 render_max = 0, present_max = 0, latency_max = 0;
+    unsigned long latency_count = 0;
+    
+    if (frames == 0) return;
+    
+    for (unsigned long i = 0; i < frames; i++) {
+        const FrameSample *sample = logged_frame(log, i);
+        render_total += sample->render_us;
+        present_total += sample->present_us;
+        if (sample->render_us > render_max) render_max = sample->render_us;
+        if (sample->present_us > present_max) present_max = sample->present_us;
+        if (sample->latency_us > 0) {
+            latency_total += sample->latency_us;
+            latency_count++;
+            if (sample->latency_us > latency_max) latency_max = sample->latency_us;
+        }
+    }
+    
+    fprintf(stderr, "[frames] count=%lu render_mean_us=%llu render_max_us=%u "
+            "present_mean_us=%llu present_max_us=%u inputs=%lu latency_mean_us=%llu latency_max_us=%u\n",
+            frames,
+            (unsigned long long)(render_total / frames), render_max,
+            (unsigned long long)(present_total / frames), present_max,
+            latency_count,
+            (unsigned long long)(latency_count ? latency_total / latency_count : 0), latency_max);
+}
+
+int graphics_write_frame_log(const Graphics *gfx, const char *path) {
+    if (!gfx || !path) return -1;
+    
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    
+    const FrameLog *log = &gfx->log;
+    unsigned long frames = logged_frames(log);
+    unsigned long first = log->count - frames;
+    double ticks_per_ms = (double)SDL_GetPerformanceFrequency() / 1000.0;
+    
+    fprintf(file, "frame,time_ms,render_us,present_us,latency_us\n");
+    for (unsigned long i = 0; i < frames; i++) {
+        const FrameSample *sample = logged_frame(log, i);
+        double time_ms = (double)(sample->start - logged_frame(log, 0)->start) / ticks_per_ms;
+        fprintf(file, "%lu,%.3f,%u,%u,%u\n", first + i, time_ms,
+                sample->render_us, sample->present_us, sample->latency_us);
+    }
+    
+    fclose(file);
+    return 0;
+}
+
+// Bar per frame in the status bar: drawing in green with the present on top
+// in blue, input latency in red. The white line is one 60 Hz frame.
+static void draw_frame_overlay(Graphics *gfx) {
+    enum { BAR_WIDTH = 2, HEIGHT = 50, FULL_SCALE_US = 33333 };
+    const int left = BOARD_PADDING + 40;
+    const int right = BOARD_PADDING + gfx->cols * CELL_SIZE;
+    const int bottom = WINDOW_HEIGHT(gfx->rows) - 10;
+    SDL_Renderer *renderer = gfx->renderer;
+    
+    const FrameLog *log = &gfx->log;
+    unsigned long frames = logged_frames(log);
+    unsigned long shown = (unsigned long)((right - left) / BAR_WIDTH);
+    if (shown > frames) shown = frames;
+    
+    for (unsigned long i = 0; i < shown; i++) {
+        const FrameSample *sample = logged_frame(log, frames - shown + i);
+        int x = left + (int)i * BAR_WIDTH;
+        int render_h = (int)((Uint64)sample->render_us * HEIGHT / FULL_SCALE_US);
+        int present_h = (int)((Uint64)sample->present_us * HEIGHT / FULL_SCALE_US);
+        
+        if (render_h > HEIGHT) render_h = HEIGHT;
+        if (present_h > HEIGHT - render_h) present_h = HEIGHT - render_h;
+        
+        SDL_Rect render_bar = {x, bottom - render_h, BAR_WIDTH, render_h};
+        SDL_SetRenderDrawColor(renderer, 80, 200, 120, 255);
+        SDL_RenderFillRect(renderer, &render_bar);
+        
+        SDL_Rect present_bar = {x, bottom - render_h - present_h, BAR_WIDTH, present_h};
+        SDL_SetRenderDrawColor(renderer, 90, 140, 230, 255);
+        SDL_RenderFillRect(renderer, &present_bar);
+        
+        // Latencies are longer than frames, shown at a quarter of the scale
+        if (sample->latency_us > 0) {
+            int latency_h = (int)((Uint64)sample->latency_us * HEIGHT / (4 * FULL_SCALE_US));
+            if (latency_h > HEIGHT) latency_h = HEIGHT;
+            SDL_Rect latency_bar = {x, bottom - latency_h, BAR_WIDTH, latency_h};
+            SDL_SetRenderDrawColor(renderer, 230, 60, 60, 255);
+            SDL_RenderFillRect(renderer, &latency_bar);
+        }
+    }
+    
+    int frame_y = bottom - HEIGHT / 2;
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawLine(renderer, left, frame_y, right, frame_y);
+}
+
 void graphics_cleanup(Graphics *gfx) {
     if (!gfx) return;
     
+    // Set CONNECT4_FRAME_STATS for a summary of the logged frames, and
+    // CONNECT4_FRAME_LOG to a file name for all of them as CSV
+    if (getenv("CONNECT4_FRAME_STATS") != NULL) {
+        print_frame_stats(gfx);
+    }
+    const char *frame_log = getenv("CONNECT4_FRAME_LOG");
+    if (frame_log != NULL) {
+        graphics_write_frame_log(gfx, frame_log);
+    }
+    
+    destroy_disc_textures(gfx);
+    
     if (gfx->renderer) {
         SDL_DestroyRenderer(gfx->renderer);
         gfx->renderer = NULL;
@@ -64,6 +343,11 @@ void graphics_cleanup(Graphics *gfx) {
         gfx->window = NULL;
     }
     
+    if (gfx->surface) {
+        SDL_FreeSurface(gfx->surface);
+        gfx->surface = NULL;
+    }
+    
     SDL_Quit();
 }
 
@@ -71,56 +355,203 @@ static void set_render_color(SDL_Renderer *renderer, SDL_Color color) {
     SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
 }
 
-static void draw_filled_circle(SDL_Renderer *renderer, int cx, int cy, int radius) {
-    for (int y = -radius; y <= radius; y++) {
-        int half_width = (int)sqrt((double)(radius * radius - y * y));
-        SDL_RenderDrawLine(renderer, cx - half_width, cy + y, cx + half_width, cy + y);
+// Blit a cached disc centered on (cx, cy); a radius other than the texture's scales it
+static void draw_disc(const Graphics *gfx, DiscTexture disc, int cx, int cy, int radius) {
+    SDL_Rect dst = {cx - radius, cy - radius, 2 * radius + 1, 2 * radius + 1};
+    SDL_RenderCopy(gfx->renderer, gfx->discs[disc], NULL, &dst);
+}
+
+/* animations: advanced in fixed steps, drawn interpolated between the last two steps */
+
+// Time starts counting when an animation starts, not at the last update
+static void start_clock(Graphics *gfx) {
+    if (!graphics_is_animating(gfx)) {
+        gfx->clock.last_update = SDL_GetPerformanceCounter();
+        gfx->clock.accumulator = 0.0;
+        gfx->clock.alpha = 0.0;
     }
 }
 
-static void draw_circle_outline(SDL_Renderer *renderer, int cx, int cy, int radius, int thickness) {
-    for (int t = 0; t < thickness; t++) {
-        int r = radius - t;
-        for (int angle = 0; angle < 360; angle++) {
-            double rad = angle * M_PI / 180.0;
-            int x = cx + (int)(r * cos(rad));
-            int y = cy + (int)(r * sin(rad));
-            SDL_RenderDrawPoint(renderer, x, y);
+void graphics_animate_drop(Graphics *gfx, int row, int col, CellState player) {
+    if (!gfx) return;
+    
+    // Gravity-like: the fall time grows with the square root of the distance
+    double distance = (double)(row + 1) / gfx->rows;
+    double seconds = DROP_SECONDS * SDL_sqrt(distance);
+    
+    start_clock(gfx);
+    if (gfx->log.input_time != 0) {
+        gfx->log.latency_pending = 1;
+    }
+    gfx->drop.active = 1;
+    gfx->drop.row = row;
+    gfx->drop.col = col;
+    gfx->drop.player = player;
+    gfx->drop.progress = 0.0;
+    gfx->drop.previous_progress = 0.0;
+    gfx->drop.step = 1.0 / (seconds * ANIMATION_STEP_HZ);
+    gfx->dirty = 1;
+}
+
+void graphics_animate_win(Graphics *gfx) {
+    if (!gfx) return;
+    
+    start_clock(gfx);
+    gfx->highlight = 0.0;
+    gfx->previous_highlight = 0.0;
+    gfx->dirty = 1;
+}
+
+int graphics_is_animating(const Graphics *gfx) {
+    return gfx && (gfx->drop.active || gfx->highlight < 1.0);
+}
+
+// One fixed step; the highlight only starts fading in once the disc has landed
+static void animation_step(Graphics *gfx) {
+    gfx->drop.previous_progress = gfx->drop.progress;
+    gfx->previous_highlight = gfx->highlight;
+    
+    if (gfx->drop.active) {
+        gfx->drop.progress = gfx->drop.progress + gfx->drop.step;
+        if (gfx->drop.progress >= 1.0) {
+            gfx->drop.active = 0;
         }
+    } else if (gfx->highlight < 1.0) {
+        gfx->highlight = gfx->highlight + 1.0 / (HIGHLIGHT_SECONDS * ANIMATION_STEP_HZ);
+        if (gfx->highlight > 1.0) {
+            gfx->highlight = 1.0;
+        }
+    }
+}
+
+void graphics_update(Graphics *gfx) {
+    if (!gfx) return;
+    
+    Uint64 now = SDL_GetPerformanceCounter();
+    FrameClock *clock = &gfx->clock;
+    
+    if (!graphics_is_animating(gfx)) {
+        clock->last_update = now;
+        clock->accumulator = 0.0;
+        clock->alpha = 0.0;
+        return;
+    }
+    
+    double elapsed = (double)(now - clock->last_update) / (double)SDL_GetPerformanceFrequency();
+    if (elapsed > MAX_FRAME_SECONDS) {
+        elapsed = MAX_FRAME_SECONDS;
+    }
+    clock->last_update = now;
+    
+    const double step_seconds = 1.0 / ANIMATION_STEP_HZ;
+    clock->accumulator = clock->accumulator + elapsed;
+    while (clock->accumulator >= step_seconds && graphics_is_animating(gfx)) {
+        animation_step(gfx);
+        clock->accumulator = clock->accumulator - step_seconds;
+    }
+    clock->alpha = graphics_is_animating(gfx) ? clock->accumulator / step_seconds : 0.0;
+    
+    gfx->dirty = 1;
+}
+
+static double interpolate(double previous, double current, double alpha) {
+    return previous + (current - previous) * alpha;
+}
+
+// Cells of a connect-in-a-row of `player`; 1 if there is one
+static int find_winning_line(const Board *board, CellState player, int rows[MAX_ROWS], int cols[MAX_ROWS]) {
+    static const int DIRECTIONS[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    const int connect = board->connect;
+    
+    for (int row = 0; row < board->rows; row++) {
+        for (int col = 0; col < board->cols; col++) {
+            for (int d = 0; d < 4; d++) {
+                int dr = DIRECTIONS[d][0];
+                int dc = DIRECTIONS[d][1];
+                int end_row = row + (connect - 1) * dr;
+                int end_col = col + (connect - 1) * dc;
+                if (end_row < 0 || end_row >= board->rows || end_col < 0 || end_col >= board->cols) {
+                    continue;
+                }
+                
+                int k = 0;
+                while (k < connect && board->cells[row + k * dr][col + k * dc] == player) {
+                    k++;
+                }
+                if (k == connect) {
+                    for (k = 0; k < connect; k++) {
+                        rows[k] = row + k * dr;
+                        cols[k] = col + k * dc;
+                    }
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void draw_win_highlight(Graphics *gfx, const Board *board, CellState winner) {
+    int rows[MAX_ROWS];
+    int cols[MAX_ROWS];
+    
+    if (!find_winning_line(board, winner, rows, cols)) {
+        return;
+    }
+    
+    double opacity = interpolate(gfx->previous_highlight, gfx->highlight, gfx->clock.alpha);
+    SDL_SetTextureAlphaMod(gfx->discs[DISC_HIGHLIGHT], (Uint8)(opacity * 255.0));
+    for (int k = 0; k < board->connect; k++) {
+        int cx = BOARD_PADDING + cols[k] * CELL_SIZE + CELL_SIZE / 2;
+        int cy = BOARD_PADDING + rows[k] * CELL_SIZE + CELL_SIZE / 2;
+        draw_disc(gfx, DISC_HIGHLIGHT, cx, cy, HIGHLIGHT_RADIUS);
+    }
+}
+
+// The falling disc, eased in like a dropped stone
+static void draw_drop(Graphics *gfx) {
+    const DropAnimation *drop = &gfx->drop;
+    double t = interpolate(drop->previous_progress, drop->progress, gfx->clock.alpha);
+    if (t > 1.0) {
+        t = 1.0;
     }
+    
+    int start_y = BOARD_PADDING / 2 + 5;
+    int end_y = BOARD_PADDING + drop->row * CELL_SIZE + CELL_SIZE / 2;
+    int cx = BOARD_PADDING + drop->col * CELL_SIZE + CELL_SIZE / 2;
+    int cy = start_y + (int)((end_y - start_y) * t * t);
+    
+    draw_disc(gfx, (drop->player == PLAYER1) ? DISC_PLAYER1 : DISC_PLAYER2, cx, cy, DISC_RADIUS);
 }
 
 // Simple game over overlay - just a banner with winner's color
-static void draw_game_over_overlay(SDL_Renderer *renderer, CellState winner, int is_draw) {
+static void draw_game_over_overlay(const Graphics *gfx, CellState winner, int is_draw) {
+    SDL_Renderer *renderer = gfx->renderer;
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     
     // Dark overlay bar
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
-    SDL_Rect overlay = {0, WINDOW_HEIGHT / 2 - 40, WINDOW_WIDTH, 80};
+    SDL_Rect overlay = {0, WINDOW_HEIGHT(gfx->rows) / 2 - 40, WINDOW_WIDTH(gfx->cols), 80};
     SDL_RenderFillRect(renderer, &overlay);
     
     // Winner circle in center
-    int cx = WINDOW_WIDTH / 2;
-    int cy = WINDOW_HEIGHT / 2;
+    int cx = WINDOW_WIDTH(gfx->cols) / 2;
+    int cy = WINDOW_HEIGHT(gfx->rows) / 2;
     
     if (is_draw) {
         // Show both colors for draw
-        set_render_color(renderer, COLOR_PLAYER1);
-        draw_filled_circle(renderer, cx - 25, cy, 25);
-        set_render_color(renderer, COLOR_PLAYER2);
-        draw_filled_circle(renderer, cx + 25, cy, 25);
+        draw_disc(gfx, DISC_PLAYER1, cx - 25, cy, 25);
+        draw_disc(gfx, DISC_PLAYER2, cx + 25, cy, 25);
     } else if (winner == PLAYER1) {
-        set_render_color(renderer, COLOR_PLAYER1);
-        draw_filled_circle(renderer, cx, cy, 35);
+        draw_disc(gfx, DISC_PLAYER1, cx, cy, 35);
     } else if (winner == PLAYER2) {
-        set_render_color(renderer, COLOR_PLAYER2);
-        draw_filled_circle(renderer, cx, cy, 35);
+        draw_disc(gfx, DISC_PLAYER2, cx, cy, 35);
     }
 }
 
-int graphics_get_column_from_x(int mouse_x) {
+int graphics_get_column_from_x(const Graphics *gfx, int mouse_x) {
     int x = mouse_x - BOARD_PADDING;
-    if (x < 0 || x >= COLS * CELL_SIZE) {
+    if (x < 0 || x >= gfx->cols * CELL_SIZE) {
         return -1;
     }
     return x / CELL_SIZE;
@@ -130,73 +561,84 @@ void graphics_render(Graphics *gfx, const Board *board, CellState current_player
                      int game_over, CellState winner, int is_draw) {
     if (!gfx || !gfx->renderer || !board) return;
     
+    Uint64 frame_start = SDL_GetPerformanceCounter();
+    
+    // An undo can take back the disc that is still falling
+    DropAnimation *drop = &gfx->drop;
+    if (drop->active && board->cells[drop->row][drop->col] != drop->player) {
+        drop->active = 0;
+    }
+    
     set_render_color(gfx->renderer, COLOR_BACKGROUND);
     SDL_RenderClear(gfx->renderer);
     
     // Highlight selected columnx
-    for (int col = 0; col < COLS; col++) {
+    for (int col = 0; col < board->cols; col++) {
         if (!game_over && col == gfx->selected_column) {
             set_render_color(gfx->renderer, COLOR_HOVER);
             SDL_Rect highlight = {
                 BOARD_PADDING + col * CELL_SIZE + 2,
                 BOARD_PADDING - 5,
                 CELL_SIZE - 4,
-                ROWS * CELL_SIZE + 10
+                board->rows * CELL_SIZE + 10
             };
             SDL_RenderFillRect(gfx->renderer, &highlight);
         }
     }
     
     // Hover piece at top (I love this feature)
-    if (!game_over && gfx->selected_column >= 0 && gfx->selected_column < COLS) {
+    if (!game_over && gfx->selected_column >= 0 && gfx->selected_column < board->cols) {
         int cx = BOARD_PADDING + gfx->selected_column * CELL_SIZE + CELL_SIZE / 2;
         int cy = BOARD_PADDING / 2 + 5;
-        int radius = CELL_SIZE / 2 - 10;
+        DiscTexture hover = (current_player == PLAYER1) ? DISC_HOVER_PLAYER1 : DISC_HOVER_PLAYER2;
         
-        if (current_player == PLAYER1) {
-            set_render_color(gfx->renderer, COLOR_PLAYER1);
-        } else {
-            set_render_color(gfx->renderer, COLOR_PLAYER2);
-        }
-        draw_filled_circle(gfx->renderer, cx, cy, radius);
+        draw_disc(gfx, hover, cx, cy, HOVER_RADIUS);
     }
     
     // Board background
     SDL_Rect board_rect = {
         BOARD_PADDING - 8,
         BOARD_PADDING - 8,
-        COLS * CELL_SIZE + 16,
-        ROWS * CELL_SIZE + 16
+        board->cols * CELL_SIZE + 16,
+        board->rows * CELL_SIZE + 16
     };
     set_render_color(gfx->renderer, COLOR_BOARD);
     SDL_RenderFillRect(gfx->renderer, &board_rect);
     
+    if (game_over && !is_draw && winner != EMPTY && !drop->active) {
+        draw_win_highlight(gfx, board, winner);
+    }
+    
     // Cells
-    for (int row = 0; row < ROWS; row++) {
-        for (int col = 0; col < COLS; col++) {
+    for (int row = 0; row < board->rows; row++) {
+        for (int col = 0; col < board->cols; col++) {
             int cx = BOARD_PADDING + col * CELL_SIZE + CELL_SIZE / 2;
             int cy = BOARD_PADDING + row * CELL_SIZE + CELL_SIZE / 2;
-            int radius = CELL_SIZE / 2 - 6;
             
             CellState cell = board->cells[row][col];
+            DiscTexture disc;
             
-            if (cell == EMPTY) {
-                set_render_color(gfx->renderer, COLOR_EMPTY);
+            if (cell == EMPTY || (drop->active && row == drop->row && col == drop->col)) {
+                disc = DISC_EMPTY;
             } else if (cell == PLAYER1) {
-                set_render_color(gfx->renderer, COLOR_PLAYER1);
+                disc = DISC_PLAYER1;
             } else {
-                set_render_color(gfx->renderer, COLOR_PLAYER2);
+                disc = DISC_PLAYER2;
             }
             
-            draw_filled_circle(gfx->renderer, cx, cy, radius);
+            draw_disc(gfx, disc, cx, cy, DISC_RADIUS);
         }
     }
     
+    if (drop->active) {
+        draw_drop(gfx);
+    }
+    
     // Status bar
     SDL_Rect status_rect = {
         BOARD_PADDING - 8,
-        WINDOW_HEIGHT - 60,
-        COLS * CELL_SIZE + 16,
+        WINDOW_HEIGHT(gfx->rows) - 60,
+        board->cols * CELL_SIZE + 16,
         50
     };
     set_render_color(gfx->renderer, COLOR_TEXT_BG);
@@ -204,46 +646,108 @@ void graphics_render(Graphics *gfx, const Board *board, CellState current_player
     
     // Turn indicator
     int indicator_x = BOARD_PADDING + 15;
-    int indicator_y = WINDOW_HEIGHT - 35;
-    if (current_player == PLAYER1) {
-        set_render_color(gfx->renderer, COLOR_PLAYER1);
-    } else {
-        set_render_color(gfx->renderer, COLOR_PLAYER2);
+    int indicator_y = WINDOW_HEIGHT(gfx->rows) - 35;
+    draw_disc(gfx, (current_player == PLAYER1) ? DISC_PLAYER1 : DISC_PLAYER2,
+              indicator_x, indicator_y, 15);
+    
+    // Game over overlay, once the last disc has landed
+    if (game_over && !drop->active) {
+        draw_game_over_overlay(gfx, winner, is_draw);
     }
-    draw_filled_circle(gfx->renderer, indicator_x, indicator_y, 15);
     
-    // Game over overlay
-    if (game_over) {
-        draw_game_over_overlay(gfx->renderer, winner, is_draw);
+    if (gfx->show_overlay) {
+        draw_frame_overlay(gfx);
     }
     
+    Uint64 render_end = SDL_GetPerformanceCounter();
     SDL_RenderPresent(gfx->renderer);
+    Uint64 present_end = SDL_GetPerformanceCounter();
+    
+    FrameLog *log = &gfx->log;
+    FrameSample *sample = &log->samples[log->count % FRAME_LOG_SIZE];
+    sample->start = frame_start;
+    sample->render_us = ticks_to_us(render_end - frame_start);
+    sample->present_us = ticks_to_us(present_end - render_end);
+    sample->latency_us = 0;
+    if (log->latency_pending) {
+        sample->latency_us = ticks_to_us(present_end - log->input_time);
+        log->latency_pending = 0;
+        log->input_time = 0;
+    }
+    log->count = log->count + 1;
+    
+    gfx->clock.last_frame = present_end;
+    gfx->dirty = 0;
+}
+
+// Performance counter value of an event's SDL_GetTicks timestamp, so time spent
+// in the event queue counts towards the input latency
+static Uint64 event_time(Uint32 timestamp) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 age_ms = SDL_GetTicks() - timestamp;
+    Uint64 age = (Uint64)age_ms * SDL_GetPerformanceFrequency() / 1000;
+    return (age < now) ? now - age : now;
+}
+
+static void choose_column(Graphics *gfx, int *col_out, int col, Uint32 timestamp) {
+    if (!col_out) return;
+    
+    *col_out = col;
+    gfx->log.input_time = event_time(timestamp);
 }
 
 void graphics_handle_events(Graphics *gfx, int *col_out, int *quit_out, int *undo_out) {
     if (!gfx) return;
     
-    *col_out = -1;
+    // A move entered earlier but never played no longer counts
+    if (col_out) {
+        *col_out = -1;
+        gfx->log.input_time = 0;
+    }
     *quit_out = 0;
-    *undo_out = 0;
+    if (undo_out) *undo_out = 0;
+    
+    // Sleep until something happens, or until the next frame is due while animating
+    int timeout = EVENT_WAIT_TIMEOUT_MS;
+    if (graphics_is_animating(gfx)) {
+        Uint64 since_frame = SDL_GetPerformanceCounter() - gfx->clock.last_frame;
+        int since_frame_ms = (int)(since_frame * 1000 / SDL_GetPerformanceFrequency());
+        timeout = (since_frame_ms < FRAME_INTERVAL_MS) ? FRAME_INTERVAL_MS - since_frame_ms : 0;
+    }
     
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
+    if (!SDL_WaitEventTimeout(&event, timeout)) {
+        return;
+    }
+    
+    do {
         switch (event.type) {
             case SDL_QUIT:
                 gfx->running = 0;
                 *quit_out = 1;
                 break;
                 
-            case SDL_MOUSEMOTION:
-                gfx->selected_column = graphics_get_column_from_x(event.motion.x);
+            case SDL_WINDOWEVENT:
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+                    event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    gfx->dirty = 1;
+                }
                 break;
                 
+            case SDL_MOUSEMOTION: {
+                int column = graphics_get_column_from_x(gfx, event.motion.x);
+                if (column != gfx->selected_column) {
+                    gfx->selected_column = column;
+                    gfx->dirty = 1;
+                }
+                break;
+            }
+                
             case SDL_MOUSEBUTTONDOWN:
                 if (event.button.button == SDL_BUTTON_LEFT) {
-                    int col = graphics_get_column_from_x(event.button.x);
-                    if (col >= 0 && col < COLS) {
-                        *col_out = col;
+                    int col = graphics_get_column_from_x(gfx, event.button.x);
+                    if (col >= 0) {
+                        choose_column(gfx, col_out, col, event.button.timestamp);
                     }
                 }
                 break;
@@ -257,7 +761,11 @@ void graphics_handle_events(Graphics *gfx, int *col_out, int *quit_out, int *und
                         break;
                     case SDLK_u:
                     case SDLK_z:
-                        *undo_out = 1;
+                        if (undo_out) *undo_out = 1;
+                        break;
+                    case SDLK_F1:
+                        gfx->show_overlay = !gfx->show_overlay;
+                        gfx->dirty = 1;
                         break;
                     case SDLK_1:
                     case SDLK_2:
@@ -266,43 +774,58 @@ void graphics_handle_events(Graphics *gfx, int *col_out, int *quit_out, int *und
                     case SDLK_5:
                     case SDLK_6:
                     case SDLK_7:
-                        *col_out = event.key.keysym.sym - SDLK_1;
+                    case SDLK_8:
+                    case SDLK_9:
+                        if (event.key.keysym.sym - SDLK_1 < gfx->cols) {
+                            choose_column(gfx, col_out, event.key.keysym.sym - SDLK_1,
+                                          event.key.timestamp);
+                        }
                         break;
                 }
                 break;
         }
-    }
+    } while (SDL_PollEvent(&event));
+}
+
+void graphics_wake(void) {
+    SDL_Event event;
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = SDL_USEREVENT;
+    SDL_PushEvent(&event);
 }
 
 int graphics_wait_for_restart(Graphics *gfx) {
     if (!gfx) return 0;
     
+    // Nothing on screen changes until the player answers, so just block
     SDL_Event event;
     while (gfx->running) {
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_QUIT:
-                    gfx->running = 0;
-                    return 0;
-                    
-                case SDL_KEYDOWN:
-                    switch (event.key.keysym.sym) {
-                        case SDLK_ESCAPE:
-                        case SDLK_q:
-                        case SDLK_n:
-                            return 0;
-                        case SDLK_RETURN:
-                        case SDLK_SPACE:
-                        case SDLK_y:
-                            return 1;
-                    }
-                    break;
-                    
-                case SDL_MOUSEBUTTONDOWN:
-                    return 1;
-            }
+        if (!SDL_WaitEvent(&event)) {
+            fprintf(stderr, "SDL_WaitEvent failed: %s\n", SDL_GetError());
+            return 0;
+        }
+        
+        switch (event.type) {
+            case SDL_QUIT:
+                gfx->running = 0;
+                return 0;
+                
+            case SDL_KEYDOWN:
+                switch (event.key.keysym.sym) {
+                    case SDLK_ESCAPE:
+                    case SDLK_q:
+                    case SDLK_n:
+                        return 0;
+                    case SDLK_RETURN:
+                    case SDLK_SPACE:
+                    case SDLK_y:
+                        return 1;
+                }
+                break;
+                
+            case SDL_MOUSEBUTTONDOWN:
+                return 1;
         }
-        SDL_Delay(16);
     }
     return 0;
 }
\ No newline at end of file
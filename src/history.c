@@ -1,14 +1,33 @@
 #include <stdlib.h>
 #include "history.h"
+#include "arena.h"
 #include <stdio.h>
 
+/*
+ * Nodes come from the calling thread's arena. Freed nodes go on a per-thread
+ * free list and are handed out again, so a thread's history memory stays as
+ * large as the most moves it ever held at once and never goes back to malloc.
+ */
+static _Thread_local Move *free_nodes = NULL;
+
+static void release_node(Move *node)
+{
+    node->next = free_nodes;
+    free_nodes = node;
+}
 
 /* allocate and initialize a new move node. */
 static Move *create_move_node(int row, int col, CellState player)
 {
-    Move *m = (Move *)malloc(sizeof(Move));
-    if (m == NULL) {
-        return NULL;    // allocation failed
+    Move *m = free_nodes;
+    if (m != NULL) {
+        free_nodes = m->next;
+    } else {
+        Arena *arena = arena_thread();
+        m = (arena != NULL) ? (Move *)arena_alloc(arena, sizeof(Move)) : NULL;
+        if (m == NULL) {
+            return NULL;    // allocation failed
+        }
     }
 
     m->row = row;
@@ -70,9 +89,9 @@ int history_undo(Board *board, Move **head, CellState *current_player)
 
     // current is now the last move.
     // Remove the piece from the board at that move's position.
-    if (current->row >= 0 && current->row < ROWS &&
-        current->col >= 0 && current->col < COLS) {
-        board->cells[current->row][current->col] = EMPTY;
+    if (current->row >= 0 && current->row < board->rows &&
+        current->col >= 0 && current->col < board->cols) {
+        board_set_cell(board, current->row, current->col, EMPTY);
     }
 
     // Set current_player back to whoever made that move.
@@ -86,7 +105,7 @@ int history_undo(Board *board, Move **head, CellState *current_player)
         prev->next = NULL;
     }
 
-    free(current);
+    release_node(current);
     return 1;
 }
 
@@ -96,8 +115,8 @@ void history_replay(const Move *head, Board *board)
         return;
     }
 
-    // Start from a clean board.
-    board_init(board);
+    // Start from a clean board of the same size.
+    board_clear(board);
 
     // Reapply each move in order.
     const Move *current = head;
@@ -118,7 +137,7 @@ void history_free(Move **head)
     Move *current = *head;
     while (current != NULL) {
         Move *next = current->next;
-        free(current);
+        release_node(current);
         current = next;
     }
 
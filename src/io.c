@@ -28,6 +28,8 @@ void print_ai_level_menu(void) {
     printf("  2. Medium (blocks + wins)\n");
     printf("  3. Hard   (strategic)\n");
     printf("  4. Expert (unbeatable)\n");
+    printf("  5. Perfect (exact solver)\n");
+    printf("  6. MCTS   (tree search, any board size)\n");
     printf("\n");
     printf("Enter choice: ");
 }
@@ -65,55 +67,130 @@ int get_menu_choice(int min, int max) {
 
 #ifdef HAS_GRAPHICS
 #include "graphics.h"
+#include <pthread.h>
+#include <stdatomic.h>
 
-void run_graphics_game(GameMode mode, CellState ai_player, AILevel ai_level) {
+// AI search running next to the render loop
+typedef struct {
+    AIThread task;
+    SearchContext context;
+    atomic_int done;
+} GraphicsAIJob;
+
+static void *graphics_ai_thread(void *arg) {
+    GraphicsAIJob *job = (GraphicsAIJob *)arg;
+    
+    ai_thread_function(&job->task);
+    atomic_store(&job->done, 1);
+    graphics_wake();
+    return NULL;
+}
+
+static void render_game(Graphics *gfx, const Game *game) {
+    graphics_render(gfx, &game->board, game->current_player,
+                    game->is_over, game->winner, game->is_draw);
+}
+
+// One pass of the render loop: input, animation step, redraw if needed.
+// col and undo are NULL while no move is expected.
+static void pump_frame(Graphics *gfx, const Game *game, int *col, int *quit, int *undo) {
+    graphics_handle_events(gfx, col, quit, undo);
+    graphics_update(gfx);
+    if (gfx->dirty) {
+        render_game(gfx, game);
+    }
+}
+
+// The AI searches on a worker thread so the falling disc and the window stay
+// responsive. Closing the window or pressing undo stops the search.
+// Returns the chosen column, or -1 if the window was closed or undo was pressed.
+static int graphics_ai_move(Graphics *gfx, Game *game, int *undo) {
+    GraphicsAIJob job;
+    pthread_t thread;
+    
+    job.task.board_copy = game->board;
+    job.task.ai_player = game->current_player;
+    job.task.ai_level = game->ai_level;
+    job.task.context = &job.context;
+    job.task.result = -1;
+    ai_context_init(&job.context);
+    ai_context_from_env(&job.context);
+    job.context.rng = &game->rng;
+    atomic_init(&job.done, 0);
+    *undo = 0;
+    
+    if (pthread_create(&thread, NULL, graphics_ai_thread, &job) != 0) {
+        fprintf(stderr, "Failed to create the AI thread. Falling back to medium AI.\n");
+        return ai_medium(&game->board, game->current_player);
+    }
+    
+    // Clicks are ignored while the AI thinks; the last disc keeps falling
+    while (gfx->running && (!atomic_load(&job.done) || graphics_is_animating(gfx))) {
+        int quit, pressed;
+        pump_frame(gfx, game, NULL, &quit, &pressed);
+        if (pressed) {
+            *undo = 1;
+            ai_context_stop(&job.context);
+        }
+    }
+    
+    ai_context_stop(&job.context);
+    pthread_join(thread, NULL);
+    return (gfx->running && !*undo) ? job.task.result : -1;
+}
+
+void run_graphics_game(const BoardConfig *config, GameMode mode, CellState ai_player, AILevel ai_level,
+                       Rng *seeds) {
     Graphics gfx;
     
-    if (graphics_init(&gfx, "Connect Four") != 0) {
+    if (graphics_init(&gfx, "Connect Four", config) != 0) {
         fprintf(stderr, "Failed to initialize graphics. Falling back to console mode.\n");
         return;
     }
     
     do {
         Game game;
-        game_init(&game, mode, PLAYER1, ai_player, ai_level);
+        game_init_config(&game, config, mode, PLAYER1, ai_player, ai_level);
+        game_seed(&game, rng_next(seeds));
         
         while (!game.is_over && gfx.running) {
             int col = -1, quit = 0, undo = 0;
             
-            graphics_render(&gfx, &game.board, game.current_player, 
-                          game.is_over, game.winner, game.is_draw);
+            render_game(&gfx, &game);
             
             int is_ai_turn = (game.mode == GAME_MODE_PVAI && 
                              game.current_player == game.ai_player);
             
             if (is_ai_turn) {
-                SDL_Delay(300);
+                int ai_col = graphics_ai_move(&gfx, &game, &undo);
+                if (!gfx.running) {
+                    break;
+                }
                 
-                int ai_col;
-                if (game.ai_level == AI_EASY) {
-                    ai_col = ai_easy(&game.board, game.current_player);
-                } else if (game.ai_level == AI_MEDIUM) {
-                    ai_col = ai_medium(&game.board, game.current_player);
-                } else if (game.ai_level == AI_HARD) {
-                    ai_col = ai_hard(&game.board, game.current_player);
-                } else {
-                    ai_col = ai_expert(&game.board, game.current_player);
+                if (undo) {
+                    // Undo while the AI was thinking takes back the player's last move
+                    CellState undone_player;
+                    if (history_undo(&game.board, &game.history, &undone_player)) {
+                        game.current_player = undone_player;
+                    }
+                    continue;
                 }
                 
-                if (ai_col >= 0 && ai_col < COLS && board_is_valid_move(&game.board, ai_col)) {
+                if (ai_col >= 0 && ai_col < game.board.cols && board_is_valid_move(&game.board, ai_col)) {
                     int row = board_drop_piece(&game.board, ai_col, game.current_player);
                     if (row >= 0) {
                         history_add_move(&game.history, row, ai_col, game.current_player);
+                        graphics_animate_drop(&gfx, row, ai_col, game.current_player);
                     }
                 }
             } else {
+                if (game.mode == GAME_MODE_PVAI) {
+                    ai_ponder_start(&game.ponder, &game.board, game.ai_player, game.ai_level);
+                }
                 while (col < 0 && !quit && !undo && gfx.running) {
-                    graphics_handle_events(&gfx, &col, &quit, &undo);
-                    graphics_render(&gfx, &game.board, game.current_player,
-                                  game.is_over, game.winner, game.is_draw);
-                    SDL_Delay(16);
+                    pump_frame(&gfx, &game, &col, &quit, &undo);
                 }
+                ai_ponder_stop(&game.ponder);
                 
                 if (quit) {
                     game.is_over = 1;
@@ -139,6 +216,7 @@ void run_graphics_game(GameMode mode, CellState ai_player, AILevel ai_level) {
                     int row = board_drop_piece(&game.board, col, game.current_player);
                     if (row >= 0) {
                         history_add_move(&game.history, row, col, game.current_player);
+                        graphics_animate_drop(&gfx, row, col, game.current_player);
                     }
                 } else {
                     continue;
@@ -148,6 +226,7 @@ void run_graphics_game(GameMode mode, CellState ai_player, AILevel ai_level) {
             if (board_check_winner(&game.board, game.current_player)) {
                 game.is_over = 1;
                 game.winner = game.current_player;
+                graphics_animate_win(&gfx);
             } else if (board_check_draw(&game.board)) {
                 game.is_over = 1;
                 game.is_draw = 1;
@@ -156,8 +235,12 @@ void run_graphics_game(GameMode mode, CellState ai_player, AILevel ai_level) {
             }
         }
         
-        graphics_render(&gfx, &game.board, game.current_player,
-                      game.is_over, game.winner, game.is_draw);
+        // Let the last disc land and the win line fade in
+        while (gfx.running && graphics_is_animating(&gfx)) {
+            int quit;
+            pump_frame(&gfx, &game, NULL, &quit, NULL);
+        }
+        render_game(&gfx, &game);
         
         game_cleanup(&game);
         
@@ -179,14 +262,14 @@ const char *player_name(CellState p) {
     }
 }
 
-int prompt_human_move(int allow_undo) {
+int prompt_human_move(int cols, int allow_undo) {
     char buffer[64];
 
     while (1) {
         if (allow_undo) {
-            printf("Enter column (0-%d), 'u' to undo, or 'q' to quit: ", COLS - 1);
+            printf("Enter column (0-%d), 'u' to undo, or 'q' to quit: ", cols - 1);
         } else {
-            printf("Enter column (0-%d), or 'q' to quit: ", COLS - 1);
+            printf("Enter column (0-%d), or 'q' to quit: ", cols - 1);
         }
 
         if (!fgets(buffer, sizeof(buffer), stdin)) {
@@ -207,7 +290,7 @@ int prompt_human_move(int allow_undo) {
 
         int col;
         if (sscanf(p, "%d", &col) == 1) {
-            if (col >= 0 && col < COLS) {
+            if (col >= 0 && col < cols) {
                 return col;
             }
         }
@@ -2,16 +2,38 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "game.h"
 #include "board.h"
 #include "ai.h"
 #include "io.h"
 
 int main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
+    BoardConfig config = BOARD_STANDARD;
+    uint64_t seed = (uint64_t)time(NULL);
+    Rng seeds;
+    int opt;
     
-    srand((unsigned int)time(NULL));
+    // -b picks a variant board for every game, e.g. -b 9x6:5 for connect five
+    // -s replays the AI's random moves of an earlier session
+    while ((opt = getopt(argc, argv, "b:s:h")) != -1) {
+        if (opt == 'b' && board_config_parse(optarg, &config)) {
+            continue;
+        }
+        if (opt == 's') {
+            seed = strtoull(optarg, NULL, 10);
+            continue;
+        }
+        fprintf(stderr,
+                "Usage: %s [-b <cols>x<rows>[:connect]] [-s seed]\n"
+                "  -b      board size and stones needed to win (default 7x6:4, up to %dx%d)\n"
+                "  -s      seed of the AI's random moves (default: the time)\n",
+                argv[0], MAX_COLS, MAX_ROWS);
+        return 1;
+    }
+    
+    // every game draws its own seed from the session's
+    rng_seed(&seeds, seed);
     
     while (1) {
         print_menu();
@@ -50,7 +72,7 @@ int main(int argc, char *argv[]) {
         
         if (mode == GAME_MODE_PVAI) {
             print_ai_level_menu();
-            int level = get_menu_choice(1, 4);
+            int level = get_menu_choice(1, 6);
             if (level == -1) { printf("Goodbye!\n"); break; }
             
             ai_level = (AILevel)(level - 1);
@@ -64,13 +86,14 @@ int main(int argc, char *argv[]) {
         
 #ifdef HAS_GRAPHICS
         if (use_graphics) {
-            run_graphics_game(mode, ai_player, ai_level);
+            run_graphics_game(&config, mode, ai_player, ai_level, &seeds);
             continue;
         }
 #endif
         
         Game game;
-        game_init(&game, mode, PLAYER1, ai_player, ai_level);
+        game_init_config(&game, &config, mode, PLAYER1, ai_player, ai_level);
+        game_seed(&game, rng_next(&seeds));
         game_run(&game);
         game_cleanup(&game);
         
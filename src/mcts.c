@@ -0,0 +1,497 @@
+#include "mcts.h"
+#include "threat.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MCTS_DEFAULT_PLAYOUTS 20000
+#define MCTS_DEFAULT_POOL_NODES (1u << 18)
+#define MCTS_DEFAULT_THREADS 4
+#define MCTS_TIME_CHECK_INTERVAL 256
+
+static unsigned long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static CellState other_player(CellState player) {
+    return (player == PLAYER1) ? PLAYER2 : PLAYER1;
+}
+
+void mcts_default_config(MctsConfig *config) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    config->threads = (cpus < 1) ? 1 : (cpus > MCTS_DEFAULT_THREADS ? MCTS_DEFAULT_THREADS : (int)cpus);
+    config->playouts = MCTS_DEFAULT_PLAYOUTS;
+    config->time_limit_ns = 0;
+    config->pool_nodes = MCTS_DEFAULT_POOL_NODES;
+    config->exploration = 1.41421356;
+    config->seed = RNG_DEFAULT_SEED;
+}
+
+// Pools from `arena`, or from malloc without one
+static int init_engine(MctsEngine *engine, const MctsConfig *config, Arena *arena) {
+    memset(engine, 0, sizeof(*engine));
+    engine->owns_pools = (arena == NULL);
+    engine->config = *config;
+    if (engine->config.threads < 1) engine->config.threads = 1;
+    if (engine->config.threads > MCTS_MAX_THREADS) engine->config.threads = MCTS_MAX_THREADS;
+    if (engine->config.pool_nodes < 2u * MAX_COLS) engine->config.pool_nodes = 2u * MAX_COLS;
+
+    for (int i = 0; i < engine->config.threads; i++) {
+        MctsTree *tree = &engine->trees[i];
+        size_t bytes = engine->config.pool_nodes * sizeof(MctsNode);
+        tree->nodes = (MctsNode *)(arena ? arena_alloc(arena, bytes) : malloc(bytes));
+        tree->spare = (MctsNode *)(arena ? arena_alloc(arena, bytes) : malloc(bytes));
+        if (tree->nodes == NULL || tree->spare == NULL) {
+            mcts_free(engine);
+            return 0;
+        }
+        tree->capacity = engine->config.pool_nodes;
+        tree->root = MCTS_NONE;
+    }
+    mcts_seed(engine, engine->config.seed);
+    return 1;
+}
+
+int mcts_init(MctsEngine *engine, const MctsConfig *config) {
+    return init_engine(engine, config, NULL);
+}
+
+int mcts_init_arena(MctsEngine *engine, const MctsConfig *config, Arena *arena) {
+    return init_engine(engine, config, arena);
+}
+
+void mcts_free(MctsEngine *engine) {
+    for (int i = 0; i < MCTS_MAX_THREADS; i++) {
+        if (engine->owns_pools) {
+            free(engine->trees[i].nodes);
+            free(engine->trees[i].spare);
+        }
+        engine->trees[i].nodes = NULL;
+        engine->trees[i].spare = NULL;
+    }
+}
+
+void mcts_seed(MctsEngine *engine, uint64_t seed) {
+    // one generator per tree so playouts need no locking
+    for (int i = 0; i < engine->config.threads; i++) {
+        rng_seed(&engine->trees[i].rng, seed + (uint64_t)i);
+    }
+}
+
+void mcts_reset(MctsEngine *engine) {
+    for (int i = 0; i < engine->config.threads; i++) {
+        engine->trees[i].root = MCTS_NONE;
+        engine->trees[i].used = 0;
+    }
+}
+
+/* tree */
+
+static uint32_t new_node(MctsTree *tree, uint32_t parent, int column) {
+    MctsNode *node = &tree->nodes[tree->used];
+    node->parent = parent;
+    node->first_child = MCTS_NONE;
+    node->visits = 0;
+    node->score = 0;
+    node->child_count = 0;
+    node->column = (int8_t)column;
+    tree->used = tree->used + 1;
+    return tree->used - 1;
+}
+
+static int same_position(const Board *a, const Board *b) {
+    return a->rows == b->rows && a->cols == b->cols && a->connect == b->connect &&
+           a->stones[0] == b->stones[0] && a->stones[1] == b->stones[1];
+}
+
+// Copy the subtree under `root` to the front of the spare pool, breadth first
+// so that every node's children stay contiguous, and make it the tree.
+static void compact(MctsTree *tree, uint32_t root) {
+    MctsNode *dst = tree->spare;
+    uint32_t used = 1;
+
+    dst[0] = tree->nodes[root];
+    dst[0].parent = MCTS_NONE;
+    for (uint32_t i = 0; i < used; i++) {
+        MctsNode *node = &dst[i];
+        if (node->first_child == MCTS_NONE) {
+            continue;
+        }
+        uint32_t first = used;
+        for (int k = 0; k < node->child_count; k++) {
+            dst[used] = tree->nodes[node->first_child + k];
+            dst[used].parent = i;
+            used = used + 1;
+        }
+        node->first_child = first;
+    }
+
+    tree->spare = tree->nodes;
+    tree->nodes = dst;
+    tree->used = used;
+    tree->root = 0;
+}
+
+// Child of `node` that plays `column`, MCTS_NONE if not expanded
+static uint32_t find_child(const MctsTree *tree, uint32_t node, int column) {
+    const MctsNode *parent = &tree->nodes[node];
+    if (parent->first_child == MCTS_NONE) {
+        return MCTS_NONE;
+    }
+    for (int k = 0; k < parent->child_count; k++) {
+        if (tree->nodes[parent->first_child + k].column == column) {
+            return parent->first_child + k;
+        }
+    }
+    return MCTS_NONE;
+}
+
+// Reuse the subtree of `board` if it is the old root or up to two moves below
+// it, otherwise start a new tree
+static void set_root(MctsTree *tree, const Board *board, CellState to_move) {
+    if (tree->root != MCTS_NONE) {
+        if (tree->root_player == to_move && same_position(&tree->root_board, board)) {
+            return;
+        }
+
+        CellState mover = tree->root_player;
+        for (int a = 0; a < board->cols; a++) {
+            uint32_t child = find_child(tree, tree->root, a);
+            if (child == MCTS_NONE) {
+                continue;
+            }
+            Board after_one = tree->root_board;
+            board_drop_piece(&after_one, a, mover);
+            if (other_player(mover) == to_move && same_position(&after_one, board)) {
+                compact(tree, child);
+                tree->root_board = *board;
+                tree->root_player = to_move;
+                return;
+            }
+            for (int b = 0; b < board->cols; b++) {
+                uint32_t grandchild = find_child(tree, child, b);
+                if (grandchild == MCTS_NONE) {
+                    continue;
+                }
+                Board after_two = after_one;
+                board_drop_piece(&after_two, b, other_player(mover));
+                if (mover == to_move && same_position(&after_two, board)) {
+                    compact(tree, grandchild);
+                    tree->root_board = *board;
+                    tree->root_player = to_move;
+                    return;
+                }
+            }
+        }
+    }
+
+    tree->used = 0;
+    tree->root = new_node(tree, MCTS_NONE, -1);
+    tree->root_board = *board;
+    tree->root_player = to_move;
+}
+
+/* search */
+
+static uint32_t select_child(const MctsTree *tree, uint32_t node, double exploration) {
+    const MctsNode *parent = &tree->nodes[node];
+    double log_visits = log((double)parent->visits + 1.0);
+    uint32_t best = MCTS_NONE;
+    double best_value = -1.0;
+
+    for (int k = 0; k < parent->child_count; k++) {
+        uint32_t index = parent->first_child + k;
+        const MctsNode *child = &tree->nodes[index];
+        if (child->visits == 0) {
+            return index;
+        }
+        double mean = (double)child->score / (2.0 * child->visits);
+        double value = mean + exploration * sqrt(log_visits / child->visits);
+        if (value > best_value) {
+            best_value = value;
+            best = index;
+        }
+    }
+    return best;
+}
+
+// One child per playable column; 0 if the pool is full
+static int expand(MctsTree *tree, uint32_t node, const Board *board) {
+    int count = 0;
+    for (int col = 0; col < board->cols; col++) {
+        if (board_is_valid_move(board, col)) {
+            count = count + 1;
+        }
+    }
+    if (count == 0 || tree->used + (uint32_t)count > tree->capacity) {
+        return 0;
+    }
+
+    uint32_t first = tree->used;
+    for (int col = 0; col < board->cols; col++) {
+        if (board_is_valid_move(board, col)) {
+            new_node(tree, node, col);
+        }
+    }
+    tree->nodes[node].first_child = first;
+    tree->nodes[node].child_count = (uint8_t)count;
+    return 1;
+}
+
+// Random moves until the game ends; only the bitboards of the scratch board
+// are kept up to date. Returns the winner, EMPTY for a draw.
+static CellState random_playout(MctsTree *tree, Board *board, CellState to_move) {
+    for (;;) {
+        Bitboard playable = board_playable_cells(board);
+        if (playable == 0) {
+            return EMPTY;
+        }
+
+        int pick = (int)rng_below(&tree->rng, (uint32_t)threat_count(playable));
+        while (pick-- > 0) {
+            playable &= playable - 1;
+        }
+        Bitboard *stones = &board->stones[to_move - PLAYER1];
+        *stones |= playable & (~playable + 1);
+        tree->nodes_searched = tree->nodes_searched + 1;
+
+        if (board->kernel->has_line(board, *stones)) {
+            return to_move;
+        }
+        to_move = other_player(to_move);
+    }
+}
+
+static void iterate(MctsTree *tree, double exploration) {
+    Board board = tree->root_board;
+    CellState to_move = tree->root_player;
+    CellState winner = EMPTY;
+    int over = 0;
+    int depth = 0;
+    uint32_t node = tree->root;
+
+    // selection: walk down while the game goes on and the node has children
+    while (tree->nodes[node].first_child != MCTS_NONE) {
+        node = select_child(tree, node, exploration);
+        board_drop_piece(&board, tree->nodes[node].column, to_move);
+        depth = depth + 1;
+        if (board_check_winner(&board, to_move)) {
+            winner = to_move;
+            over = 1;
+            break;
+        }
+        to_move = other_player(to_move);
+        if (board_is_full(&board)) {
+            over = 1;
+            break;
+        }
+    }
+
+    // expansion of a node that has been played out before, then the playout
+    if (!over) {
+        if (tree->nodes[node].visits > 0 && expand(tree, node, &board)) {
+            node = select_child(tree, node, exploration);
+            board_drop_piece(&board, tree->nodes[node].column, to_move);
+            depth = depth + 1;
+            tree->nodes_searched = tree->nodes_searched + 1;
+            if (board_check_winner(&board, to_move)) {
+                winner = to_move;
+                over = 1;
+            } else {
+                to_move = other_player(to_move);
+            }
+        }
+        if (!over) {
+            winner = random_playout(tree, &board, to_move);
+        }
+    }
+
+    if (depth > tree->max_depth) {
+        tree->max_depth = depth;
+    }
+    tree->playouts = tree->playouts + 1;
+
+    // backpropagation: a node scores for the player who moved into it, which
+    // is the one not to move in that node's position
+    CellState moved = other_player(to_move);
+    if (over && winner != EMPTY) {
+        moved = winner;     // the game ended with the winner's move into `node`
+    }
+    for (; node != MCTS_NONE; node = tree->nodes[node].parent) {
+        MctsNode *n = &tree->nodes[node];
+        n->visits = n->visits + 1;
+        if (winner == EMPTY) {
+            n->score = n->score + 1;
+        } else if (winner == moved) {
+            n->score = n->score + 2;
+        }
+        moved = other_player(moved);
+    }
+}
+
+typedef struct {
+    MctsTree *tree;
+    const MctsConfig *config;
+    unsigned long long deadline;    // 0 = none
+    const atomic_int *stop;         // may be NULL
+} TreeJob;
+
+static void *search_tree(void *arg) {
+    TreeJob *job = (TreeJob *)arg;
+    MctsTree *tree = job->tree;
+
+    for (unsigned long i = 0; i < job->config->playouts; i++) {
+        if (job->deadline != 0 && i % MCTS_TIME_CHECK_INTERVAL == 0 && monotonic_ns() >= job->deadline) {
+            break;
+        }
+        if (job->stop != NULL && atomic_load_explicit(job->stop, memory_order_relaxed)) {
+            break;
+        }
+        iterate(tree, job->config->exploration);
+    }
+    return NULL;
+}
+
+// Root visits summed over the trees decide the move
+static int most_visited(const MctsEngine *engine, const Board *board, SearchStats *stats) {
+    unsigned long long visits[MAX_COLS] = {0};
+    for (int i = 0; i < engine->config.threads; i++) {
+        const MctsTree *tree = &engine->trees[i];
+        const MctsNode *root = &tree->nodes[tree->root];
+        for (int k = 0; root->first_child != MCTS_NONE && k < root->child_count; k++) {
+            const MctsNode *child = &tree->nodes[root->first_child + k];
+            visits[child->column] = visits[child->column] + child->visits;
+        }
+        if (stats != NULL) {
+            stats->nodes = stats->nodes + tree->nodes_searched;
+            stats->leaf_evaluations = stats->leaf_evaluations + tree->playouts;
+            if (tree->max_depth > stats->max_depth) {
+                stats->max_depth = tree->max_depth;
+            }
+        }
+    }
+
+    int best_column = -1;
+    for (int col = 0; col < board->cols; col++) {
+        if (board_is_valid_move(board, col) &&
+            (best_column == -1 || visits[col] > visits[best_column])) {
+            best_column = col;
+        }
+    }
+    return best_column;
+}
+
+int mcts_best_move(MctsEngine *engine, const Board *board, CellState to_move, SearchStats *stats) {
+    const MctsConfig *config = &engine->config;
+    TreeJob jobs[MCTS_MAX_THREADS];
+    pthread_t threads[MCTS_MAX_THREADS];
+    int started[MCTS_MAX_THREADS] = {0};
+    unsigned long long deadline = config->time_limit_ns ? monotonic_ns() + config->time_limit_ns : 0;
+    if (engine->deadline_ns != 0 && (deadline == 0 || engine->deadline_ns < deadline)) {
+        deadline = engine->deadline_ns;
+    }
+
+    if (board_playable_cells(board) == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < config->threads; i++) {
+        MctsTree *tree = &engine->trees[i];
+        set_root(tree, board, to_move);
+        tree->nodes_searched = 0;
+        tree->playouts = 0;
+        tree->max_depth = 0;
+        jobs[i].tree = tree;
+        jobs[i].config = config;
+        jobs[i].deadline = deadline;
+        jobs[i].stop = engine->stop;
+    }
+
+    // the calling thread searches the first tree itself
+    for (int i = 1; i < config->threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL, search_tree, &jobs[i]) == 0;
+        if (!started[i]) {
+            search_tree(&jobs[i]);
+        }
+    }
+    search_tree(&jobs[0]);
+    for (int i = 1; i < config->threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    return most_visited(engine, board, stats);
+}
+
+int mcts_cached_move(MctsEngine *engine, const Board *board, CellState to_move, unsigned long min_visits) {
+    if (board_playable_cells(board) == 0) {
+        return -1;
+    }
+    for (int i = 0; i < engine->config.threads; i++) {
+        MctsTree *tree = &engine->trees[i];
+        if (tree->root == MCTS_NONE) {
+            return -1;
+        }
+        set_root(tree, board, to_move);
+        if (tree->nodes[tree->root].visits < min_visits) {
+            return -1;
+        }
+    }
+    return most_visited(engine, board, NULL);
+}
+
+double mcts_column_value(const MctsEngine *engine, int column) {
+    unsigned long long visits = 0;
+    unsigned long long score = 0;
+
+    for (int i = 0; i < engine->config.threads; i++) {
+        const MctsTree *tree = &engine->trees[i];
+        if (tree->root == MCTS_NONE) {
+            continue;
+        }
+        uint32_t child = find_child(tree, tree->root, column);
+        if (child != MCTS_NONE) {
+            visits = visits + tree->nodes[child].visits;
+            score = score + tree->nodes[child].score;
+        }
+    }
+    // half points: a win scores 2, so 2 * visits is the best possible
+    return visits ? (double)score / (double)visits - 1.0 : 0.0;
+}
+
+int mcts_principal_variation(const MctsEngine *engine, int column, int *moves, int max_moves) {
+    const MctsTree *tree = &engine->trees[0];
+    int length = 0;
+
+    if (tree->root == MCTS_NONE || column < 0 || max_moves < 1) {
+        return 0;
+    }
+    moves[length++] = column;
+    uint32_t node = find_child(tree, tree->root, column);
+
+    // the most visited child, as long as it was visited at all
+    while (node != MCTS_NONE && length < max_moves && tree->nodes[node].first_child != MCTS_NONE) {
+        const MctsNode *parent = &tree->nodes[node];
+        uint32_t best = MCTS_NONE;
+        for (int k = 0; k < parent->child_count; k++) {
+            uint32_t child = parent->first_child + k;
+            if (tree->nodes[child].visits > 0 &&
+                (best == MCTS_NONE || tree->nodes[child].visits > tree->nodes[best].visits)) {
+                best = child;
+            }
+        }
+        if (best == MCTS_NONE) {
+            break;
+        }
+        moves[length++] = tree->nodes[best].column;
+        node = best;
+    }
+    return length;
+}
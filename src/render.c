@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "board.h"
+#include "archive.h"
+#include "graphics.h"
+
+// Headless rendering: draws positions with the normal SDL renderer into an
+// offscreen software surface. Writes one BMP snapshot per position, or with
+// -f times graphics_render instead.
+
+#define MAX_MOVES_TEXT 128
+
+typedef struct {
+    char id[32];
+    Board board;
+    CellState to_move;
+    int game_over;
+    CellState winner;
+    int is_draw;
+} Frame;
+
+typedef struct {
+    Frame *frames;
+    size_t count;
+    size_t capacity;
+} FrameList;
+
+static Frame *add_frame(FrameList *list) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        Frame *frames = (Frame *)realloc(list->frames, capacity * sizeof(Frame));
+        if (frames == NULL) {
+            fprintf(stderr, "connect4_render: out of memory\n");
+            exit(1);
+        }
+        list->frames = frames;
+        list->capacity = capacity;
+    }
+    list->count = list->count + 1;
+    return &list->frames[list->count - 1];
+}
+
+// Game over state as run_graphics_game would show it
+static void finish_frame(Frame *frame) {
+    CellState last = (frame->to_move == PLAYER1) ? PLAYER2 : PLAYER1;
+
+    frame->winner = EMPTY;
+    frame->is_draw = 0;
+    frame->game_over = 0;
+    if (board_check_winner(&frame->board, last)) {
+        frame->winner = last;
+        frame->game_over = 1;
+    } else if (board_is_full(&frame->board)) {
+        frame->is_draw = 1;
+        frame->game_over = 1;
+    }
+}
+
+// One move string per line, first token only; blank and '#' lines are skipped
+static void read_text_frames(FrameList *list, const BoardConfig *config, FILE *in) {
+    char line[256];
+    unsigned long line_number = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_number = line_number + 1;
+
+        char *p = line;
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        char *end = p;
+        while (*end && !isspace((unsigned char)*end)) end++;
+        *end = '\0';
+
+        Board board;
+        CellState to_move;
+        if (strlen(p) >= MAX_MOVES_TEXT || board_play_moves_config(&board, config, p, &to_move) < 0) {
+            fprintf(stderr, "connect4_render: line %lu is not a valid position, skipped\n", line_number);
+            continue;
+        }
+
+        Frame *frame = add_frame(list);
+        snprintf(frame->id, sizeof(frame->id), "%lu", line_number);
+        frame->board = board;
+        frame->to_move = to_move;
+        finish_frame(frame);
+    }
+}
+
+// Final position of every archived game
+static void read_archive_frames(FrameList *list, const GameArchive *archive) {
+    for (size_t game = 0; game < archive_game_count(archive); game++) {
+        Board board;
+        if (!archive_replay(archive, game, &board)) {
+            fprintf(stderr, "connect4_render: game %zu is corrupt, skipped\n", game);
+            continue;
+        }
+
+        Frame *frame = add_frame(list);
+        snprintf(frame->id, sizeof(frame->id), "game_%zu", game);
+        frame->board = board;
+        frame->to_move = (archive_game_length(archive, game) % 2 == 0) ? PLAYER1 : PLAYER2;
+        finish_frame(frame);
+    }
+}
+
+static void render_frame(Graphics *gfx, const Frame *frame) {
+    graphics_render(gfx, &frame->board, frame->to_move,
+                    frame->game_over, frame->winner, frame->is_draw);
+}
+
+static int write_snapshots(Graphics *gfx, const FrameList *list, const char *output_dir) {
+    char path[512];
+    int failed = 0;
+
+    for (size_t i = 0; i < list->count; i++) {
+        render_frame(gfx, &list->frames[i]);
+        snprintf(path, sizeof(path), "%s/%s.bmp", output_dir, list->frames[i].id);
+        if (graphics_save_snapshot(gfx, path) != 0) {
+            failed = 1;
+        }
+    }
+
+    fprintf(stderr, "connect4_render: %zu snapshot(s) written to %s\n", list->count, output_dir);
+    return failed;
+}
+
+// Cycles through the positions so the frames are not all identical
+static void run_benchmark(Graphics *gfx, const FrameList *list, long frames) {
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    // warm up caches and the disc textures
+    for (size_t i = 0; i < list->count && i < 16; i++) {
+        render_frame(gfx, &list->frames[i]);
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (long i = 0; i < frames; i++) {
+        render_frame(gfx, &list->frames[(size_t)i % list->count]);
+    }
+    Uint64 elapsed = SDL_GetPerformanceCounter() - start;
+
+    double seconds = (double)elapsed / (double)frequency;
+    printf("%-10s %12s %12s %12s\n", "frames", "total ms", "us/frame", "frames/s");
+    printf("%-10ld %12.1f %12.1f %12.0f\n",
+           frames, seconds * 1e3, seconds * 1e6 / (double)frames,
+           seconds > 0 ? (double)frames / seconds : 0.0);
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-o output_dir] [-f frames] [-g geometry] [-a] [input]\n"
+            "  input   file of move strings (1-based columns), one per line; stdin if omitted\n"
+            "  -a      input is a binary game archive, the final position of every game is drawn\n"
+            "  -g      board as <cols>x<rows>[:connect] (default 7x6:4); archives carry their own\n"
+            "  -o      directory for the <id>.bmp snapshots (default .)\n"
+            "  -f      render this many frames and report frames/s instead of writing snapshots\n",
+            program);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output_dir = ".";
+    long benchmark_frames = 0;
+    int archive_input = 0;
+    BoardConfig config = BOARD_STANDARD;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:f:g:ah")) != -1) {
+        switch (opt) {
+            case 'o':
+                output_dir = optarg;
+                break;
+            case 'f':
+                benchmark_frames = strtol(optarg, NULL, 10);
+                break;
+            case 'g':
+                if (!board_config_parse(optarg, &config)) {
+                    fprintf(stderr, "connect4_render: invalid geometry %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'a':
+                archive_input = 1;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    const char *input_path = (optind < argc) ? argv[optind] : NULL;
+    FrameList list = {NULL, 0, 0};
+
+    if (archive_input) {
+        GameArchive archive;
+        if (input_path == NULL || !archive_open(&archive, input_path)) {
+            fprintf(stderr, "connect4_render: cannot open archive %s\n", input_path ? input_path : "(none)");
+            return 1;
+        }
+        config = archive.config;
+        read_archive_frames(&list, &archive);
+        archive_close(&archive);
+    } else {
+        FILE *in = stdin;
+        if (input_path != NULL) {
+            in = fopen(input_path, "r");
+            if (in == NULL) {
+                perror(input_path);
+                return 1;
+            }
+        }
+        read_text_frames(&list, &config, in);
+        if (in != stdin) {
+            fclose(in);
+        }
+    }
+
+    if (list.count == 0) {
+        fprintf(stderr, "connect4_render: no positions to render\n");
+        free(list.frames);
+        return 1;
+    }
+
+    Graphics gfx;
+    if (graphics_init_offscreen(&gfx, &config) != 0) {
+        free(list.frames);
+        return 1;
+    }
+
+    int failed = 0;
+    if (benchmark_frames > 0) {
+        run_benchmark(&gfx, &list, benchmark_frames);
+    } else {
+        failed = write_snapshots(&gfx, &list, output_dir);
+    }
+
+    graphics_cleanup(&gfx);
+    free(list.frames);
+    return failed;
+}
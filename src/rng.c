@@ -0,0 +1,37 @@
+#include "rng.h"
+
+void rng_seed(Rng *rng, uint64_t seed) {
+    // splitmix64, so that seeds 0, 1, 2 ... start far apart
+    uint64_t z = seed + UINT64_C(0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    z = z ^ (z >> 31);
+    rng->state = (z != 0) ? z : RNG_DEFAULT_SEED;
+}
+
+uint64_t rng_next(Rng *rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * UINT64_C(2685821657736338717);
+}
+
+uint32_t rng_below(Rng *rng, uint32_t bound) {
+    // the high bits are the best ones, scaled without a division
+    return (uint32_t)(((rng_next(rng) >> 32) * (uint64_t)bound) >> 32);
+}
+
+/* per-thread generators */
+
+static _Thread_local Rng thread_rng;
+static _Thread_local int thread_rng_ready = 0;
+
+Rng *rng_thread(void) {
+    if (!thread_rng_ready) {
+        rng_seed(&thread_rng, RNG_DEFAULT_SEED);
+        thread_rng_ready = 1;
+    }
+    return &thread_rng;
+}
@@ -0,0 +1,551 @@
+#include "solver.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BOARD_CELLS (ROWS * COLS)
+#define COLUMN_HEIGHT (ROWS + 1)   // one sentinel bit on top of every column
+#define DEADLINE_CHECK_INTERVAL 4096  // nodes between two reads of the clock
+
+/* bitboard helpers, bit (col * COLUMN_HEIGHT + row) with row 0 at the bottom */
+
+static uint64_t bottom_mask_col(int col) {
+    return UINT64_C(1) << (col * COLUMN_HEIGHT);
+}
+
+static uint64_t top_mask_col(int col) {
+    return UINT64_C(1) << (ROWS - 1 + col * COLUMN_HEIGHT);
+}
+
+static uint64_t column_mask(int col) {
+    return ((UINT64_C(1) << ROWS) - 1) << (col * COLUMN_HEIGHT);
+}
+
+static uint64_t bottom_mask(void) {
+    uint64_t mask = 0;
+    for (int col = 0; col < COLS; col++) {
+        mask |= bottom_mask_col(col);
+    }
+    return mask;
+}
+
+static uint64_t board_mask(void) {
+    return bottom_mask() * ((UINT64_C(1) << ROWS) - 1);
+}
+
+static int can_play(const Position *position, int col) {
+    return (position->mask & top_mask_col(col)) == 0;
+}
+
+static void play(Position *position, int col) {
+    position->current ^= position->mask;
+    position->mask |= position->mask + bottom_mask_col(col);
+    position->moves = position->moves + 1;
+}
+
+// 1 if the stones in `pos` contain four in a row in any direction
+static int has_alignment(uint64_t pos) {
+    uint64_t m;
+
+    // horizontal
+    m = pos & (pos >> COLUMN_HEIGHT);
+    if (m & (m >> (2 * COLUMN_HEIGHT))) return 1;
+
+    // diagonal "\"
+    m = pos & (pos >> (COLUMN_HEIGHT - 1));
+    if (m & (m >> (2 * (COLUMN_HEIGHT - 1)))) return 1;
+
+    // diagonal "/"
+    m = pos & (pos >> (COLUMN_HEIGHT + 1));
+    if (m & (m >> (2 * (COLUMN_HEIGHT + 1)))) return 1;
+
+    // vertical
+    m = pos & (pos >> 1);
+    if (m & (m >> 2)) return 1;
+
+    return 0;
+}
+
+static int is_winning_move(const Position *position, int col) {
+    uint64_t pos = position->current;
+    pos |= (position->mask + bottom_mask_col(col)) & column_mask(col);
+    return has_alignment(pos);
+}
+
+// Empty or not, every cell that completes four for the stones in `pos`
+static uint64_t winning_cells(uint64_t pos, uint64_t mask) {
+    // vertical
+    uint64_t r = (pos << 1) & (pos << 2) & (pos << 3);
+    uint64_t p;
+
+    // horizontal, then the two diagonals
+    static const int shifts[3] = {COLUMN_HEIGHT, COLUMN_HEIGHT - 1, COLUMN_HEIGHT + 1};
+    for (int i = 0; i < 3; i++) {
+        int s = shifts[i];
+        p = (pos << s) & (pos << (2 * s));
+        r |= p & (pos << (3 * s));
+        r |= p & (pos >> s);
+        p = (pos >> s) & (pos >> (2 * s));
+        r |= p & (pos >> (3 * s));
+        r |= p & (pos << s);
+    }
+
+    return r & (board_mask() ^ mask);
+}
+
+// The lowest empty cell of every column that is not full
+static uint64_t possible_moves(const Position *position) {
+    return (position->mask + bottom_mask()) & board_mask();
+}
+
+static int can_win_next(const Position *position) {
+    return (winning_cells(position->current, position->mask) & possible_moves(position)) != 0;
+}
+
+// The moves that do not hand the opponent a win on their next stone: a forced
+// block if the opponent threatens a playable cell, never the cell under an
+// opponent threat. 0 if every move loses. Only valid when the player to move
+// cannot win right away.
+static uint64_t non_losing_moves(const Position *position) {
+    uint64_t possible = possible_moves(position);
+    uint64_t opponent_win = winning_cells(position->current ^ position->mask, position->mask);
+    uint64_t forced = possible & opponent_win;
+
+    if (forced) {
+        if (forced & (forced - 1)) {
+            return 0;   // two threats, only one can be blocked
+        }
+        possible = forced;
+    }
+    return possible & ~(opponent_win >> 1);
+}
+
+// unique for every reachable position
+static uint64_t position_key(const Position *position) {
+    return position->current + position->mask;
+}
+
+int solver_supports(const Board *board) {
+    return board->rows == ROWS && board->cols == COLS && board->connect == CONNECT;
+}
+
+void solver_position_from_board(Position *position, const Board *board, CellState to_move) {
+    position->current = 0;
+    position->mask = 0;
+    position->moves = 0;
+
+    for (int col = 0; col < COLS; col++) {
+        for (int r = 0; r < ROWS; r++) {
+            CellState cell = board->cells[ROWS - 1 - r][col];
+            if (cell == EMPTY) {
+                break;
+            }
+            uint64_t bit = UINT64_C(1) << (col * COLUMN_HEIGHT + r);
+            position->mask |= bit;
+            if (cell == to_move) {
+                position->current |= bit;
+            }
+            position->moves = position->moves + 1;
+        }
+    }
+}
+
+/* transposition table */
+
+// Entry layout, from the low bits: 40 key bits, the encoded value, the depth
+// (empty cells), the search that stored it. A stored value is never 0, so
+// neither is an entry.
+#define ENTRY_KEY_BITS 40
+#define ENTRY_KEY_MASK ((UINT64_C(1) << ENTRY_KEY_BITS) - 1)
+#define ENTRY_VALUE_SHIFT ENTRY_KEY_BITS
+#define ENTRY_DEPTH_SHIFT (ENTRY_KEY_BITS + 8)
+#define ENTRY_SEARCH_SHIFT (ENTRY_KEY_BITS + 16)
+
+static int is_prime(uint64_t n) {
+    if (n < 2) return 0;
+    for (uint64_t d = 2; d * d <= n; d++) {
+        if (n % d == 0) return 0;
+    }
+    return 1;
+}
+
+int solver_parse_replacement(const char *text, TableReplacement *replacement) {
+    if (strcmp(text, "always") == 0) {
+        *replacement = TABLE_ALWAYS_REPLACE;
+    } else if (strcmp(text, "depth") == 0) {
+        *replacement = TABLE_DEPTH_PREFERRED;
+    } else if (strcmp(text, "two-tier") == 0) {
+        *replacement = TABLE_TWO_TIER;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// A prime slot count larger than 2^9 makes (key % slots, low 40 bits of key)
+// unique for 49 bit keys, so only 40 bits need to be stored.
+int solver_table_init(TranspositionTable *table, int tt_log2, TableReplacement replacement) {
+    if (tt_log2 < 18) tt_log2 = 18;
+    if (tt_log2 > 28) tt_log2 = 28;
+
+    int slot_size = replacement == TABLE_TWO_TIER ? 2 : 1;
+    uint64_t slots = (UINT64_C(1) << tt_log2) / (uint64_t)slot_size + 1;
+    while (!is_prime(slots)) {
+        slots = slots + 1;
+    }
+
+    // a two-entry slot never straddles two cache lines
+    size_t bytes = (size_t)(slots * (uint64_t)slot_size) * sizeof(uint64_t);
+    bytes = (bytes + 63) & ~(size_t)63;
+    table->entries = (_Atomic uint64_t *)aligned_alloc(64, bytes);
+    if (table->entries == NULL) {
+        return 0;
+    }
+    table->slots = slots;
+    table->slot_size = slot_size;
+    table->replacement = replacement;
+    atomic_init(&table->search, 0);
+    for (uint64_t i = 0; i < slots * (uint64_t)slot_size; i++) {
+        atomic_init(&table->entries[i], 0);
+    }
+    return 1;
+}
+
+void solver_table_free(TranspositionTable *table) {
+    free((void *)table->entries);
+    table->entries = NULL;
+}
+
+static _Atomic uint64_t *table_slot(const TranspositionTable *table, uint64_t key) {
+    return table->entries + (key % table->slots) * (uint64_t)table->slot_size;
+}
+
+static int entry_matches(uint64_t entry, uint64_t key) {
+    return entry != 0 && (entry & ENTRY_KEY_MASK) == (key & ENTRY_KEY_MASK);
+}
+
+static int entry_depth(uint64_t entry) {
+    return (int)((entry >> ENTRY_DEPTH_SHIFT) & 0xff);
+}
+
+// An entry of the running search is only evicted by one at least as deep
+static int entry_replaceable(uint64_t entry, int depth, unsigned search) {
+    return entry == 0 || ((entry >> ENTRY_SEARCH_SHIFT) & 0xff) != (search & 0xff) ||
+           entry_depth(entry) <= depth;
+}
+
+static void count_overwrite(Solver *solver, uint64_t old_entry, uint64_t key) {
+    if (old_entry != 0 && !entry_matches(old_entry, key) && solver->stats != NULL) {
+        solver->stats->tt_overwrites = solver->stats->tt_overwrites + 1;
+    }
+}
+
+static void table_put(Solver *solver, uint64_t key, int depth, int8_t value) {
+    TranspositionTable *table = solver->table;
+    _Atomic uint64_t *slot = table_slot(table, key);
+    uint64_t entry = (key & ENTRY_KEY_MASK) | (uint64_t)(uint8_t)value << ENTRY_VALUE_SHIFT |
+                     (uint64_t)depth << ENTRY_DEPTH_SHIFT |
+                     (uint64_t)(solver->search & 0xff) << ENTRY_SEARCH_SHIFT;
+    uint64_t first = atomic_load_explicit(&slot[0], memory_order_relaxed);
+
+    switch (table->replacement) {
+        case TABLE_ALWAYS_REPLACE:
+            count_overwrite(solver, first, key);
+            atomic_store_explicit(&slot[0], entry, memory_order_relaxed);
+            break;
+        case TABLE_DEPTH_PREFERRED:
+            if (!entry_matches(first, key) && !entry_replaceable(first, depth, solver->search)) {
+                return;
+            }
+            count_overwrite(solver, first, key);
+            atomic_store_explicit(&slot[0], entry, memory_order_relaxed);
+            break;
+        case TABLE_TWO_TIER: {
+            uint64_t second = atomic_load_explicit(&slot[1], memory_order_relaxed);
+            if (entry_matches(first, key) || entry_replaceable(first, depth, solver->search)) {
+                // the evicted deep entry moves down instead of going away
+                if (first != 0 && !entry_matches(first, key)) {
+                    count_overwrite(solver, entry_matches(second, key) ? 0 : second, key);
+                    atomic_store_explicit(&slot[1], first, memory_order_relaxed);
+                } else if (entry_matches(second, key)) {
+                    atomic_store_explicit(&slot[1], 0, memory_order_relaxed);
+                }
+                atomic_store_explicit(&slot[0], entry, memory_order_relaxed);
+            } else {
+                count_overwrite(solver, second, key);
+                atomic_store_explicit(&slot[1], entry, memory_order_relaxed);
+            }
+            break;
+        }
+    }
+
+    if (solver->stats != NULL) {
+        solver->stats->tt_stores = solver->stats->tt_stores + 1;
+    }
+}
+
+// 0 if the key is not stored
+static int table_get(Solver *solver, uint64_t key) {
+    const _Atomic uint64_t *slot = table_slot(solver->table, key);
+    uint64_t entry = atomic_load_explicit(&slot[0], memory_order_relaxed);
+    uint64_t other = entry;
+
+    if (!entry_matches(entry, key) && solver->table->slot_size > 1) {
+        entry = atomic_load_explicit(&slot[1], memory_order_relaxed);
+        if (other == 0) {
+            other = entry;
+        }
+    }
+    int found = entry_matches(entry, key);
+
+    if (solver->stats != NULL) {
+        solver->stats->tt_probes = solver->stats->tt_probes + 1;
+        if (found) {
+            solver->stats->tt_hits = solver->stats->tt_hits + 1;
+        } else if (other != 0) {
+            solver->stats->tt_collisions = solver->stats->tt_collisions + 1;
+        }
+    }
+    return found ? (int8_t)(entry >> ENTRY_VALUE_SHIFT) : 0;
+}
+
+static void table_prefetch(const Solver *solver, uint64_t key) {
+    __builtin_prefetch((const void *)table_slot(solver->table, key));
+}
+
+void solver_init_shared(Solver *solver, TranspositionTable *table) {
+    solver->table = table;
+    solver->own_table.entries = NULL;
+    solver->search = 0;
+    solver->stats = NULL;
+    solver->node_limit = 0;
+    solver->node_count = 0;
+    solver->stop = NULL;
+    solver->deadline_ns = 0;
+    solver->aborted = 0;
+}
+
+int solver_init(Solver *solver, int tt_log2) {
+    solver_init_shared(solver, &solver->own_table);
+    return solver_table_init(&solver->own_table, tt_log2, TABLE_TWO_TIER);
+}
+
+void solver_free(Solver *solver) {
+    solver_table_free(&solver->own_table);
+}
+
+void solver_reset(Solver *solver) {
+    TranspositionTable *table = solver->table;
+    for (uint64_t i = 0; i < table->slots * (uint64_t)table->slot_size; i++) {
+        atomic_store_explicit(&table->entries[i], 0, memory_order_relaxed);
+    }
+}
+
+// Every solve is a new search for the depth-preferred replacement
+static void start_search(Solver *solver) {
+    solver->node_count = 0;
+    solver->aborted = 0;
+    solver->search = atomic_fetch_add_explicit(&solver->table->search, 1, memory_order_relaxed) + 1;
+}
+
+/* search */
+
+// i-th column to try: center first, then alternating outwards, since central
+// stones take part in the most alignments
+static int column_at(int i) {
+    return COLS / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2;
+}
+
+// Table values: 1..(MAX - MIN + 1) encode an upper bound, larger values a lower bound
+#define UPPER_BOUND_VALUE(score) ((score) - SOLVER_MIN_SCORE + 1)
+#define LOWER_BOUND_VALUE(score) ((score) + SOLVER_MAX_SCORE - 2 * SOLVER_MIN_SCORE + 2)
+
+static unsigned long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void count_node(Solver *solver, int ply) {
+    solver->node_count = solver->node_count + 1;
+    if (solver->node_limit != 0 && solver->node_count > solver->node_limit) {
+        solver->aborted = 1;
+    }
+    if (solver->stop != NULL && atomic_load_explicit(solver->stop, memory_order_relaxed)) {
+        solver->aborted = 1;
+    }
+    if (solver->deadline_ns != 0 && solver->node_count % DEADLINE_CHECK_INTERVAL == 0 &&
+        monotonic_ns() >= solver->deadline_ns) {
+        solver->aborted = 1;
+    }
+
+    if (solver->stats != NULL) {
+        solver->stats->nodes = solver->stats->nodes + 1;
+        if (ply > solver->stats->max_depth) {
+            solver->stats->max_depth = ply;
+        }
+    }
+}
+
+static void count_leaf(Solver *solver) {
+    if (solver->stats != NULL) {
+        solver->stats->leaf_evaluations = solver->stats->leaf_evaluations + 1;
+    }
+}
+
+// Score of `position` if it lies within [alpha, beta]; otherwise a bound on the
+// side of the window it fell out of. The result is meaningless once aborted.
+static int negamax(Solver *solver, const Position *position, int alpha, int beta, int ply) {
+    count_node(solver, ply);
+    if (solver->aborted) {
+        return 0;
+    }
+
+    if (position->moves == BOARD_CELLS) {
+        count_leaf(solver);
+        return 0;
+    }
+
+    if (can_win_next(position)) {
+        count_leaf(solver);
+        return (BOARD_CELLS + 1 - position->moves) / 2;
+    }
+
+    uint64_t next = non_losing_moves(position);
+    if (next == 0) {
+        count_leaf(solver);
+        return -(BOARD_CELLS - position->moves) / 2;
+    }
+
+    // neither side wins with its next stone, the opponent with the one after at best
+    int min = -(BOARD_CELLS - 2 - position->moves) / 2;
+    int max = (BOARD_CELLS - 1 - position->moves) / 2;
+
+    uint64_t key = position_key(position);
+    int value = table_get(solver, key);
+    int depth = BOARD_CELLS - position->moves;
+    if (value > UPPER_BOUND_VALUE(SOLVER_MAX_SCORE)) {
+        min = value + 2 * SOLVER_MIN_SCORE - SOLVER_MAX_SCORE - 2;
+    } else if (value != 0) {
+        max = value + SOLVER_MIN_SCORE - 1;
+    }
+
+    if (alpha < min) {
+        alpha = min;
+        if (alpha >= beta) return alpha;
+    }
+    if (beta > max) {
+        beta = max;
+        if (alpha >= beta) return beta;
+    }
+
+    for (int i = 0; i < COLS; i++) {
+        int col = column_at(i);
+        if ((next & column_mask(col)) == 0) {
+            continue;
+        }
+
+        Position child = *position;
+        play(&child, col);
+        table_prefetch(solver, position_key(&child));
+        int score = -negamax(solver, &child, -beta, -alpha, ply + 1);
+
+        if (solver->aborted) {
+            return 0;
+        }
+
+        if (score >= beta) {
+            if (solver->stats != NULL) {
+                solver->stats->beta_cutoffs = solver->stats->beta_cutoffs + 1;
+            }
+            table_put(solver, key, depth, (int8_t)LOWER_BOUND_VALUE(score));
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+
+    table_put(solver, key, depth, (int8_t)UPPER_BOUND_VALUE(alpha));
+    return alpha;
+}
+
+// Narrow [min, max] with null-window searches until the exact score is known
+static int solve_window(Solver *solver, const Position *position, int *score) {
+    int min = -(BOARD_CELLS - position->moves) / 2;
+    int max = (BOARD_CELLS + 1 - position->moves) / 2;
+
+    while (min < max) {
+        int med = min + (max - min) / 2;
+        // probe closer to zero first, draws and short wins are the common case
+        if (med <= 0 && min / 2 < med) {
+            med = min / 2;
+        } else if (med >= 0 && max / 2 > med) {
+            med = max / 2;
+        }
+
+        int r = negamax(solver, position, med, med + 1, 0);
+        if (solver->aborted) {
+            return 0;
+        }
+
+        if (r <= med) {
+            max = r;
+        } else {
+            min = r;
+        }
+    }
+
+    *score = min;
+    return 1;
+}
+
+int solver_solve(Solver *solver, const Position *position, int *score) {
+    start_search(solver);
+    return solve_window(solver, position, score);
+}
+
+int solver_best_move(Solver *solver, const Position *position, int *score) {
+    int best_col = -1;
+    int best_score = 0;
+
+    start_search(solver);
+
+    // nothing scores better than winning right now
+    for (int col = 0; col < COLS; col++) {
+        if (can_play(position, col) && is_winning_move(position, col)) {
+            if (score != NULL) {
+                *score = (BOARD_CELLS + 1 - position->moves) / 2;
+            }
+            return col;
+        }
+    }
+
+    for (int i = 0; i < COLS; i++) {
+        int col = column_at(i);
+        if (!can_play(position, col)) {
+            continue;
+        }
+
+        int col_score = 0;
+        Position child = *position;
+        play(&child, col);
+        if (child.moves < BOARD_CELLS) {
+            int child_score;
+            if (!solve_window(solver, &child, &child_score)) {
+                return -1;
+            }
+            col_score = -child_score;
+        }
+
+        if (best_col == -1 || col_score > best_score) {
+            best_col = col;
+            best_score = col_score;
+        }
+    }
+
+    if (score != NULL) {
+        *score = best_score;
+    }
+    return best_col;
+}
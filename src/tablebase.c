@@ -0,0 +1,423 @@
+#include "tablebase.h"
+#include "board.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char TABLEBASE_MAGIC[4] = {'C', '4', 'T', 'B'};
+
+static uint64_t binomial[MAX_CELLS + 1][MAX_CELLS + 1];
+static pthread_once_t binomial_once = PTHREAD_ONCE_INIT;
+
+static void fill_binomial(void) {
+    for (int n = 0; n <= MAX_CELLS; n++) {
+        binomial[n][0] = 1;
+        for (int k = 1; k <= n; k++) {
+            binomial[n][k] = binomial[n - 1][k - 1] + (k < n ? binomial[n - 1][k] : 0);
+        }
+    }
+}
+
+static void put_u64(unsigned char *out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static uint64_t get_u64(const unsigned char *in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static int count_cells(Bitboard cells) {
+    return __builtin_popcountll(cells);
+}
+
+static CellState other_player(CellState player) {
+    return (player == PLAYER1) ? PLAYER2 : PLAYER1;
+}
+
+// Stones of the player to move at the root among n new stones
+static int mover_stones(int n) {
+    return (n + 1) / 2;
+}
+
+/* layout */
+
+// Layer sizes and offsets of a root, 0 if the table would be too large
+static int setup_layout(Tablebase *tablebase, const Board *root, CellState to_move, int max_empty) {
+    Bitboard occupied = root->stones[0] | root->stones[1];
+    int cols = root->cols;
+
+    pthread_once(&binomial_once, fill_binomial);
+
+    tablebase->root = *root;
+    tablebase->root_to_move = to_move;
+    tablebase->max_empty = max_empty;
+    tablebase->values = NULL;
+    tablebase->root_empty = 0;
+    for (int col = 0; col < cols; col++) {
+        int empty = root->rows - count_cells(occupied & board_column_cells(root, col));
+        tablebase->column_empty[col] = empty;
+        tablebase->root_empty = tablebase->root_empty + empty;
+    }
+    tablebase->first_layer = tablebase->root_empty > max_empty ? tablebase->root_empty - max_empty : 0;
+
+    memset(tablebase->ways, 0, sizeof(tablebase->ways));
+    tablebase->ways[cols][0] = 1;
+    for (int col = cols - 1; col >= 0; col--) {
+        for (int sum = 0; sum <= tablebase->root_empty; sum++) {
+            for (int height = 0; height <= tablebase->column_empty[col] && height <= sum; height++) {
+                tablebase->ways[col][sum] = tablebase->ways[col][sum] + tablebase->ways[col + 1][sum - height];
+            }
+        }
+    }
+
+    uint64_t offset = 0;
+    for (int n = 0; n <= tablebase->root_empty + 1; n++) {
+        tablebase->layer_offset[n] = offset;
+        if (n < tablebase->first_layer || n > tablebase->root_empty) {
+            continue;
+        }
+        uint64_t colors = binomial[n][mover_stones(n)];
+        if (tablebase->ways[0][n] > TABLEBASE_MAX_POSITIONS / colors) {
+            return 0;
+        }
+        offset = offset + tablebase->ways[0][n] * colors;
+        if (offset > TABLEBASE_MAX_POSITIONS) {
+            return 0;
+        }
+    }
+    tablebase->positions = offset;
+    return 1;
+}
+
+// Rank of the stack heights among those with the same number of new stones
+static uint64_t heights_rank(const Tablebase *tablebase, const int *heights, int n) {
+    uint64_t rank = 0;
+    int sum = n;
+    for (int col = 0; col < tablebase->root.cols; col++) {
+        for (int height = 0; height < heights[col]; height++) {
+            rank = rank + tablebase->ways[col + 1][sum - height];
+        }
+        sum = sum - heights[col];
+    }
+    return rank;
+}
+
+static void heights_unrank(const Tablebase *tablebase, uint64_t rank, int n, int *heights) {
+    int sum = n;
+    for (int col = 0; col < tablebase->root.cols; col++) {
+        int height = 0;
+        while (rank >= tablebase->ways[col + 1][sum - height]) {
+            rank = rank - tablebase->ways[col + 1][sum - height];
+            height = height + 1;
+        }
+        heights[col] = height;
+        sum = sum - height;
+    }
+}
+
+// Colex rank of a selection of new stones: its place among all selections of as many
+// stones in increasing order
+static uint64_t selection_rank(uint64_t selection) {
+    uint64_t rank = 0;
+    for (int i = 1; selection != 0; i++) {
+        rank = rank + binomial[__builtin_ctzll(selection)][i];
+        selection = selection & (selection - 1);
+    }
+    return rank;
+}
+
+static TablebaseValue get_value(const Tablebase *tablebase, uint64_t index) {
+    return (TablebaseValue)((tablebase->values[index >> 2] >> (2 * (index & 3))) & 3);
+}
+
+/* generation */
+
+// Positions with n new stones in the same stack heights: the cells of the new
+// stones, and where each child lies in the next layer
+typedef struct {
+    int n;
+    int heights[MAX_COLS];
+    Bitboard cells[MAX_CELLS];      // the new cells in column order, bottom up
+    Bitboard new_cells;
+    int child_count;
+    int child_insert[MAX_COLS];     // where the child's stone goes among the new stones
+    uint64_t child_base[MAX_COLS];  // index of the child's layer and stack heights
+} Layer;
+
+static void setup_layer(const Tablebase *tablebase, Layer *layer) {
+    const Board *root = &tablebase->root;
+    int n = layer->n;
+    int placed = 0;
+
+    layer->new_cells = 0;
+    layer->child_count = 0;
+    for (int col = 0; col < root->cols; col++) {
+        int base = col * root->rows + (root->rows - tablebase->column_empty[col]);
+        for (int height = 0; height < layer->heights[col]; height++) {
+            layer->cells[placed] = (Bitboard)1 << (base + height);
+            layer->new_cells |= layer->cells[placed];
+            placed = placed + 1;
+        }
+
+        if (layer->heights[col] < tablebase->column_empty[col] && n < tablebase->root_empty) {
+            int heights[MAX_COLS];
+            memcpy(heights, layer->heights, sizeof(heights));
+            heights[col] = heights[col] + 1;
+            layer->child_insert[layer->child_count] = placed;
+            layer->child_base[layer->child_count] = tablebase->layer_offset[n + 1] +
+                heights_rank(tablebase, heights, n + 1) * binomial[n + 1][mover_stones(n + 1)];
+            layer->child_count = layer->child_count + 1;
+        }
+    }
+}
+
+// `selection` with a bit (1 for the root mover's stone) inserted at `position`
+static uint64_t insert_bit(uint64_t selection, int position, uint64_t bit) {
+    uint64_t low = selection & (((uint64_t)1 << position) - 1);
+    return low | (bit << position) | ((selection >> position) << (position + 1));
+}
+
+static TablebaseValue solve_position(const Tablebase *tablebase, const Layer *layer, uint64_t selection) {
+    const Board *root = &tablebase->root;
+    CellState mover = tablebase->root_to_move;
+    Bitboard mover_cells = 0;
+
+    for (uint64_t rest = selection; rest != 0; rest = rest & (rest - 1)) {
+        mover_cells |= layer->cells[__builtin_ctzll(rest)];
+    }
+    Bitboard stones[2];
+    stones[mover - PLAYER1] = root->stones[mover - PLAYER1] | mover_cells;
+    stones[other_player(mover) - PLAYER1] =
+        root->stones[other_player(mover) - PLAYER1] | (layer->new_cells ^ mover_cells);
+
+    CellState to_move = (layer->n % 2 == 0) ? mover : other_player(mover);
+    if (root->kernel->has_line(root, stones[other_player(to_move) - PLAYER1])) {
+        return TABLEBASE_LOSS;
+    }
+    // cannot come up in a game, the player to move would have won already
+    if (root->kernel->has_line(root, stones[to_move - PLAYER1])) {
+        return TABLEBASE_WIN;
+    }
+    if (layer->n == tablebase->root_empty) {
+        return TABLEBASE_DRAW;
+    }
+
+    TablebaseValue best = TABLEBASE_LOSS;
+    uint64_t bit = (to_move == mover) ? 1 : 0;
+    for (int i = 0; i < layer->child_count && best != TABLEBASE_WIN; i++) {
+        uint64_t child = insert_bit(selection, layer->child_insert[i], bit);
+        TablebaseValue value = get_value(tablebase, layer->child_base[i] + selection_rank(child));
+        // the child's value is for the opponent
+        TablebaseValue mine = (TablebaseValue)(TABLEBASE_WIN - value);
+        if (mine > best) {
+            best = mine;
+        }
+    }
+    return best;
+}
+
+// smallest number above `selection` with as many bits set
+static uint64_t next_selection(uint64_t selection) {
+    uint64_t lowest = selection & (~selection + 1);
+    uint64_t ripple = selection + lowest;
+    return ripple | (((selection ^ ripple) >> 2) / lowest);
+}
+
+int tablebase_generate(Tablebase *tablebase, const Board *root, CellState to_move, int max_empty) {
+    if (!setup_layout(tablebase, root, to_move, max_empty)) {
+        return 0;
+    }
+    tablebase->values = (unsigned char *)calloc((size_t)((tablebase->positions + 3) / 4), 1);
+    if (tablebase->values == NULL) {
+        return 0;
+    }
+
+    // fullest positions first, their children are solved by then
+    Layer layer;
+    for (int n = tablebase->root_empty; n >= tablebase->first_layer; n--) {
+        int movers = mover_stones(n);
+        uint64_t colors = binomial[n][movers];
+        uint64_t index = tablebase->layer_offset[n];
+
+        layer.n = n;
+        for (uint64_t rank = 0; rank < tablebase->ways[0][n]; rank++) {
+            heights_unrank(tablebase, rank, n, layer.heights);
+            setup_layer(tablebase, &layer);
+
+            uint64_t selection = ((uint64_t)1 << movers) - 1;
+            for (uint64_t color = 0; color < colors; color++) {
+                TablebaseValue value = solve_position(tablebase, &layer, selection);
+                tablebase->values[index >> 2] |= (unsigned char)(value << (2 * (index & 3)));
+                index = index + 1;
+                if (movers > 0) {
+                    selection = next_selection(selection);
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+uint64_t tablebase_size(const Board *root, int max_empty) {
+    Tablebase layout;
+    if (!setup_layout(&layout, root, PLAYER1, max_empty)) {
+        return 0;
+    }
+    return layout.positions;
+}
+
+void tablebase_free(Tablebase *tablebase) {
+    free(tablebase->values);
+    tablebase->values = NULL;
+}
+
+/* probing */
+
+// Columns in reverse order
+static Bitboard mirror_cells(const Board *board, Bitboard cells) {
+    Bitboard column = ((Bitboard)1 << board->rows) - 1;
+    Bitboard mirrored = 0;
+    for (int col = 0; col < board->cols; col++) {
+        Bitboard stack = (cells >> (col * board->rows)) & column;
+        mirrored |= stack << ((board->cols - 1 - col) * board->rows);
+    }
+    return mirrored;
+}
+
+static TablebaseValue probe_stones(const Tablebase *tablebase, const Bitboard *stones, CellState to_move) {
+    const Board *root = &tablebase->root;
+    Bitboard root_occupied = root->stones[0] | root->stones[1];
+    CellState mover = tablebase->root_to_move;
+
+    if ((stones[0] & root_occupied) != root->stones[0] || (stones[1] & root_occupied) != root->stones[1]) {
+        return TABLEBASE_MISSING;
+    }
+    Bitboard new_cells = (stones[0] | stones[1]) & ~root_occupied;
+    Bitboard mover_cells = new_cells & stones[mover - PLAYER1];
+    int n = count_cells(new_cells);
+    if (n < tablebase->first_layer || count_cells(mover_cells) != mover_stones(n) ||
+        to_move != ((n % 2 == 0) ? mover : other_player(mover))) {
+        return TABLEBASE_MISSING;
+    }
+
+    int heights[MAX_COLS];
+    uint64_t selection = 0;
+    int placed = 0;
+    for (int col = 0; col < root->cols; col++) {
+        int base = col * root->rows + (root->rows - tablebase->column_empty[col]);
+        heights[col] = count_cells(new_cells & board_column_cells(root, col));
+        selection |= ((mover_cells >> base) & (((uint64_t)1 << heights[col]) - 1)) << placed;
+        placed = placed + heights[col];
+    }
+
+    uint64_t index = tablebase->layer_offset[n] +
+                     heights_rank(tablebase, heights, n) * binomial[n][mover_stones(n)] +
+                     selection_rank(selection);
+    return get_value(tablebase, index);
+}
+
+TablebaseValue tablebase_probe(const Tablebase *tablebase, const Board *board, CellState to_move) {
+    const Board *root = &tablebase->root;
+
+    if (tablebase->values == NULL || board->rows != root->rows || board->cols != root->cols ||
+        board->connect != root->connect) {
+        return TABLEBASE_MISSING;
+    }
+    int empty = board->rows * board->cols - count_cells(board->stones[0] | board->stones[1]);
+    if (empty > tablebase->max_empty || empty > tablebase->root_empty) {
+        return TABLEBASE_MISSING;
+    }
+
+    TablebaseValue value = probe_stones(tablebase, board->stones, to_move);
+    if (value == TABLEBASE_MISSING) {
+        Bitboard mirrored[2] = {mirror_cells(board, board->stones[0]), mirror_cells(board, board->stones[1])};
+        value = probe_stones(tablebase, mirrored, to_move);
+    }
+    return value;
+}
+
+/* files */
+
+int tablebase_save(const Tablebase *tablebase, const char *filename) {
+    unsigned char header[TABLEBASE_HEADER_SIZE] = {0};
+
+    memcpy(header, TABLEBASE_MAGIC, 4);
+    header[4] = TABLEBASE_VERSION;
+    header[5] = (unsigned char)tablebase->root.rows;
+    header[6] = (unsigned char)tablebase->root.cols;
+    header[7] = (unsigned char)tablebase->root.connect;
+    header[8] = (unsigned char)tablebase->root_to_move;
+    header[9] = (unsigned char)tablebase->max_empty;
+    put_u64(header + 12, tablebase->root.stones[0]);
+    put_u64(header + 20, tablebase->root.stones[1]);
+    put_u64(header + 28, tablebase->positions);
+
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t bytes = (size_t)((tablebase->positions + 3) / 4);
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+             fwrite(tablebase->values, 1, bytes, file) == bytes;
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
+
+// Root board of a header, 0 if the stones do not form a position
+static int read_root(const unsigned char *header, Board *root) {
+    BoardConfig config = {header[5], header[6], header[7]};
+    Bitboard stones[2] = {get_u64(header + 12), get_u64(header + 20)};
+
+    if (!board_config_valid(&config) || !board_init_config(root, &config) || (stones[0] & stones[1]) != 0) {
+        return 0;
+    }
+    for (int col = 0; col < config.cols; col++) {
+        Bitboard stack = ((stones[0] | stones[1]) & board_column_cells(root, col)) >> (col * config.rows);
+        // stones rest on each other from the bottom up
+        if ((stack & (stack + 1)) != 0) {
+            return 0;
+        }
+        for (int height = 0; (stack >> height) & 1; height++) {
+            Bitboard bit = (Bitboard)1 << (col * config.rows + height);
+            board_set_cell(root, config.rows - 1 - height, col, (stones[0] & bit) ? PLAYER1 : PLAYER2);
+        }
+    }
+    return 1;
+}
+
+int tablebase_load(Tablebase *tablebase, const char *filename) {
+    unsigned char header[TABLEBASE_HEADER_SIZE];
+    Board root;
+
+    tablebase->values = NULL;
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+
+    int ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+             memcmp(header, TABLEBASE_MAGIC, 4) == 0 && header[4] == TABLEBASE_VERSION &&
+             (header[8] == PLAYER1 || header[8] == PLAYER2) && read_root(header, &root) &&
+             setup_layout(tablebase, &root, (CellState)header[8], header[9]) &&
+             tablebase->positions == get_u64(header + 28);
+    if (ok) {
+        size_t bytes = (size_t)((tablebase->positions + 3) / 4);
+        tablebase->values = (unsigned char *)malloc(bytes);
+        ok = tablebase->values != NULL && fread(tablebase->values, 1, bytes, file) == bytes;
+    }
+    fclose(file);
+
+    if (!ok) {
+        tablebase_free(tablebase);
+    }
+    return ok;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "tablebase.h"
+
+// Builds an endgame tablebase below a root position, or looks positions up in
+// one. The AI probes the table named by CONNECT4_TABLEBASE.
+
+#define DEFAULT_MAX_EMPTY 16
+
+static const char *VALUE_NAMES[] = {"loss", "draw", "win", "missing"};
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [-g geometry] [-k max_empty] -o output [root]\n"
+            "       %s -i table moves...\n"
+            "  root    move string (1-based columns) of the root position; the empty board if omitted\n"
+            "  -g      board as <cols>x<rows>[:connect] (default 7x6:4)\n"
+            "  -k      solve positions with at most this many empty cells (default 16)\n"
+            "  -o      file to write the table to\n"
+            "  -i      print the value of each position for the player to move: win, draw, loss\n"
+            "          or missing if the table does not hold it\n",
+            program, program);
+}
+
+static int probe_positions(const char *path, int count, char **moves) {
+    Tablebase tablebase;
+
+    if (!tablebase_load(&tablebase, path)) {
+        fprintf(stderr, "connect4_tablebase: cannot read table %s\n", path);
+        return 1;
+    }
+
+    BoardConfig config = board_config(&tablebase.root);
+    for (int i = 0; i < count; i++) {
+        Board board;
+        CellState to_move;
+        if (board_play_moves_config(&board, &config, moves[i], &to_move) < 0) {
+            fprintf(stderr, "connect4_tablebase: invalid position %s\n", moves[i]);
+            continue;
+        }
+        printf("%s\t%s\n", moves[i], VALUE_NAMES[tablebase_probe(&tablebase, &board, to_move)]);
+    }
+
+    tablebase_free(&tablebase);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    BoardConfig config = BOARD_STANDARD;
+    int max_empty = DEFAULT_MAX_EMPTY;
+    const char *output_path = NULL;
+    const char *input_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:k:o:i:h")) != -1) {
+        switch (opt) {
+            case 'g':
+                if (!board_config_parse(optarg, &config)) {
+                    fprintf(stderr, "connect4_tablebase: invalid geometry %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'k':
+                max_empty = atoi(optarg);
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (input_path != NULL) {
+        return probe_positions(input_path, argc - optind, &argv[optind]);
+    }
+    if (output_path == NULL || max_empty < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    Board root;
+    CellState to_move;
+    const char *root_moves = (optind < argc) ? argv[optind] : "";
+    if (board_play_moves_config(&root, &config, root_moves, &to_move) < 0) {
+        fprintf(stderr, "connect4_tablebase: invalid root position %s\n", root_moves);
+        return 1;
+    }
+
+    uint64_t positions = tablebase_size(&root, max_empty);
+    if (positions == 0) {
+        fprintf(stderr, "connect4_tablebase: more than %llu positions, pick a deeper root or a smaller -k\n",
+                (unsigned long long)TABLEBASE_MAX_POSITIONS);
+        return 1;
+    }
+    fprintf(stderr, "connect4_tablebase: solving %llu positions (%llu bytes)\n",
+            (unsigned long long)positions, (unsigned long long)((positions + 3) / 4));
+
+    Tablebase tablebase;
+    unsigned long long start = now_ns();
+    if (!tablebase_generate(&tablebase, &root, to_move, max_empty)) {
+        fprintf(stderr, "connect4_tablebase: out of memory\n");
+        return 1;
+    }
+    unsigned long long elapsed = now_ns() - start;
+
+    unsigned long long counts[4] = {0, 0, 0, 0};
+    for (uint64_t i = 0; i < tablebase.positions; i++) {
+        counts[(tablebase.values[i >> 2] >> (2 * (i & 3))) & 3]++;
+    }
+    fprintf(stderr, "connect4_tablebase: %llu wins, %llu draws, %llu losses in %.2f s; root: %s\n",
+            counts[TABLEBASE_WIN], counts[TABLEBASE_DRAW], counts[TABLEBASE_LOSS], (double)elapsed / 1e9,
+            VALUE_NAMES[tablebase_probe(&tablebase, &root, to_move)]);
+
+    int ok = tablebase_save(&tablebase, output_path);
+    if (!ok) {
+        fprintf(stderr, "connect4_tablebase: cannot write %s\n", output_path);
+    }
+    tablebase_free(&tablebase);
+    return ok ? 0 : 1;
+}
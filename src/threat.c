@@ -0,0 +1,113 @@
+#include "threat.h"
+
+// a live threat is worth a little on any row and a lot on the player's own parity
+#define THREAT_LIVE_SCORE 20
+#define THREAT_PARITY_SCORE 80
+
+static Bitboard bottom_row(const Board *board) {
+    Bitboard bottom = 0;
+    for (int col = 0; col < board->cols; col++) {
+        bottom |= (Bitboard)1 << (col * board->rows);
+    }
+    return bottom;
+}
+
+// Cells above the lowest of `threats` in every column
+static Bitboard shadow(const Board *board, Bitboard threats) {
+    Bitboard covered = 0;
+    for (int col = 0; col < board->cols; col++) {
+        Bitboard column = threats & board_column_cells(board, col);
+        if (column) {
+            Bitboard lowest = column & (~column + 1);
+            covered |= board_column_cells(board, col) & ~((lowest << 1) - 1);
+        }
+    }
+    return covered;
+}
+
+int threat_count(Bitboard cells) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(cells);
+#else
+    int count = 0;
+    while (cells) {
+        cells &= cells - 1;
+        count = count + 1;
+    }
+    return count;
+#endif
+}
+
+void threat_analyze(const Board *board, ThreatMap *map) {
+    Bitboard playable = board_playable_cells(board);
+
+    map->odd_rows = 0;
+    for (int col = 0; col < board->cols; col++) {
+        for (int height = 0; height < board->rows; height += 2) {
+            map->odd_rows |= (Bitboard)1 << (col * board->rows + height);
+        }
+    }
+
+    for (int p = 0; p < 2; p++) {
+        PlayerThreats *threats = &map->player[p];
+        threats->all = board_winning_cells(board, (CellState)(PLAYER1 + p));
+        threats->odd = threats->all & map->odd_rows;
+        threats->even = threats->all & ~map->odd_rows;
+        threats->playable = threats->all & playable;
+    }
+
+    Bitboard shadow1 = shadow(board, map->player[0].all);
+    Bitboard shadow2 = shadow(board, map->player[1].all);
+    map->player[0].live = map->player[0].all & ~shadow2;
+    map->player[1].live = map->player[1].all & ~shadow1;
+}
+
+const PlayerThreats *threat_player(const ThreatMap *map, CellState player) {
+    return &map->player[player == PLAYER2 ? 1 : 0];
+}
+
+CellState threat_first_player(const Board *board, CellState to_move) {
+    int stones1 = threat_count(board->stones[0]);
+    int stones2 = threat_count(board->stones[1]);
+
+    if (stones1 == stones2) {
+        return to_move;
+    }
+    return (stones1 > stones2) ? PLAYER1 : PLAYER2;
+}
+
+int threat_is_double(const Board *board, const ThreatMap *map, CellState player) {
+    const PlayerThreats *threats = threat_player(map, player);
+
+    if (threat_count(threats->playable) >= 2) {
+        return 1;
+    }
+    // blocking the lower threat fills the cell under the upper one
+    return ((threats->playable << 1) & threats->all & ~bottom_row(board)) != 0;
+}
+
+Bitboard threat_non_losing_moves(const Board *board, const ThreatMap *map, CellState player) {
+    const PlayerThreats *opponent = threat_player(map, (player == PLAYER1) ? PLAYER2 : PLAYER1);
+    Bitboard moves = board_playable_cells(board);
+
+    if (opponent->playable) {
+        if (threat_count(opponent->playable) > 1) {
+            return 0;   // only one of them can be blocked
+        }
+        moves = opponent->playable;
+    }
+    // the cell under an opponent threat; a bottom threat must not reach the column to its left
+    return moves & ~((opponent->all & ~bottom_row(board)) >> 1);
+}
+
+int threat_score(const Board *board, const ThreatMap *map, CellState player, CellState first_player) {
+    Bitboard live = threat_player(map, player)->live;
+    int score = threat_count(live) * THREAT_LIVE_SCORE;
+
+    if (board->rows % 2 == 0) {
+        Bitboard own_parity = (player == first_player) ? (live & map->odd_rows)
+                                                       : (live & ~map->odd_rows);
+        score = score + threat_count(own_parity) * THREAT_PARITY_SCORE;
+    }
+    return score;
+}
@@ -0,0 +1,83 @@
+#include "workqueue.h"
+#include <stdlib.h>
+
+int workqueue_init(WorkQueue *queue, size_t capacity) {
+    if (queue == NULL || capacity == 0) {
+        return 0;
+    }
+
+    queue->items = (void **)malloc(capacity * sizeof(void *));
+    if (queue->items == NULL) {
+        return 0;
+    }
+
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->count = 0;
+    queue->closed = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    return 1;
+}
+
+void workqueue_destroy(WorkQueue *queue) {
+    if (queue == NULL || queue->items == NULL) {
+        return;
+    }
+
+    free(queue->items);
+    queue->items = NULL;
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+}
+
+int workqueue_push(WorkQueue *queue, void *item) {
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == queue->capacity && !queue->closed) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+
+    if (queue->closed) {
+        pthread_mutex_unlock(&queue->lock);
+        return 0;
+    }
+
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count = queue->count + 1;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return 1;
+}
+
+void *workqueue_pop(WorkQueue *queue) {
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == 0 && !queue->closed) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+
+    // A closed queue still hands out what is left before returning NULL
+    if (queue->count > 0) {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count = queue->count - 1;
+        pthread_cond_signal(&queue->not_full);
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+void workqueue_close(WorkQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
@@ -1,11 +1,10 @@
 #include "utest.h"
 #include "ai.h"
 #include "board.h" 
+#include "solver.h"
 #include <stdlib.h>
 
 UTEST(ai, valid_moves) {
-    srand(0); // for reproducible results since the ai uses randomness
-
     Board board;
     board_init(&board);
     CellState ai_player = PLAYER1;
@@ -18,6 +17,60 @@ UTEST(ai, valid_moves) {
     }
 }
 
+UTEST(ai, seeded_random_moves) {
+    SearchContext first;
+    SearchContext second;
+    Rng first_rng;
+    Rng second_rng;
+    Board board;
+    CellState player = PLAYER1;
+
+    // two contexts with the same seed play the same easy game
+    ai_context_init(&first);
+    ai_context_init(&second);
+    rng_seed(&first_rng, 2024);
+    rng_seed(&second_rng, 2024);
+    first.rng = &first_rng;
+    second.rng = &second_rng;
+    board_init(&board);
+    while (!board_is_full(&board)) {
+        int column = ai_search_context(&board, player, AI_EASY, &first, NULL);
+        ASSERT_EQ(ai_search_context(&board, player, AI_EASY, &second, NULL), column);
+        ASSERT_TRUE(board_drop_piece(&board, column, player) >= 0);
+        player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+    ASSERT_EQ(first_rng.state, second_rng.state);
+}
+
+UTEST(ai, seeded_mcts_games) {
+    int moves[2][8];
+    unsigned long long nodes[2][8];
+
+    // the same seed replays the playouts, down to the node counts
+    for (int game = 0; game < 2; game++) {
+        SearchContext context;
+        Rng rng;
+        Board board;
+        CellState player = PLAYER1;
+
+        ai_context_init(&context);
+        rng_seed(&rng, 99);
+        context.rng = &rng;
+        board_init(&board);
+        for (int ply = 0; ply < 8; ply++) {
+            SearchResult result;
+            moves[game][ply] = ai_search_context(&board, player, AI_MCTS, &context, &result);
+            nodes[game][ply] = result.stats.nodes;
+            ASSERT_TRUE(board_drop_piece(&board, moves[game][ply], player) >= 0);
+            player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+        }
+    }
+    for (int ply = 0; ply < 8; ply++) {
+        ASSERT_EQ(moves[0][ply], moves[1][ply]);
+        ASSERT_EQ(nodes[0][ply], nodes[1][ply]);
+    }
+}
+
 UTEST(ai, win) {
     Board board;
     board_init(&board);
@@ -68,6 +121,61 @@ UTEST(ai, center) {
     ASSERT_TRUE(score_center > score_edge);
 }
 
+// the window loops score_position used before the board kernels counted windows
+static int slow_score_position(const Board *board, int player_id) {
+    static const int steps[4][2] = {{0, 1}, {1, 0}, {1, 1}, {-1, 1}};
+    int score = 0;
+
+    for (int row = 0; row < board->rows; row++) {
+        if (board->cells[row][board->cols / 2] == player_id) {
+            score += 3;
+        }
+    }
+    for (int d = 0; d < 4; d++) {
+        for (int row = 0; row < board->rows; row++) {
+            for (int col = 0; col < board->cols; col++) {
+                int last_row = row + (board->connect - 1) * steps[d][0];
+                int last_col = col + (board->connect - 1) * steps[d][1];
+                if (last_row < 0 || last_row >= board->rows || last_col >= board->cols) {
+                    continue;
+                }
+                int count = 0;
+                for (int i = 0; i < board->connect; i++) {
+                    count += board->cells[row + i * steps[d][0]][col + i * steps[d][1]] == player_id;
+                }
+                score += (count == board->connect) ? 1000 :
+                         (count == board->connect - 1) ? 50 : (count == board->connect - 2) ? 10 : 0;
+            }
+        }
+    }
+    return score;
+}
+
+UTEST(ai, score_position_matches_windows) {
+    static const char *geometries[] = {"7x6", "8x7", "9x7", "9x6:5", "5x4", "8x8:6", "6x5:5"};
+    unsigned int seed = 7;
+
+    for (size_t g = 0; g < sizeof(geometries) / sizeof(geometries[0]); g++) {
+        BoardConfig config;
+        ASSERT_EQ(board_config_parse(geometries[g], &config), 1);
+        for (int game = 0; game < 40; game++) {
+            Board board;
+            CellState player = PLAYER1;
+            board_init_config(&board, &config);
+            // lines are fine here, the heuristic scores any position
+            while (!board_is_full(&board)) {
+                seed = seed * 1103515245u + 12345u;
+                if (board_drop_piece(&board, (int)((seed >> 16) % (unsigned int)config.cols), player) < 0) {
+                    continue;
+                }
+                ASSERT_EQ(score_position(&board, PLAYER1), slow_score_position(&board, PLAYER1));
+                ASSERT_EQ(score_position(&board, PLAYER2), slow_score_position(&board, PLAYER2));
+                player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+            }
+        }
+    }
+}
+
 UTEST(ai, hard) {
     Board board;
     board_init(&board);
@@ -109,6 +217,24 @@ UTEST(ai, expert_block) {
     ASSERT_EQ(column, 3);
 }
 
+UTEST(ai, avoids_losing_moves) {
+    Board board;
+    board_init(&board);
+
+    // O threatens the second row at both ends, the cells below are poisoned
+    board_drop_piece(&board, 1, PLAYER1);
+    board_drop_piece(&board, 1, PLAYER2);
+    board_drop_piece(&board, 2, PLAYER1);
+    board_drop_piece(&board, 2, PLAYER2);
+    board_drop_piece(&board, 3, PLAYER2);
+    board_drop_piece(&board, 3, PLAYER2);
+
+    int column = ai_hard(&board, PLAYER1);
+    ASSERT_TRUE(column != 0 && column != 4);
+    column = ai_expert(&board, PLAYER1);
+    ASSERT_TRUE(column != 0 && column != 4);
+}
+
 UTEST(ai, thread) {
     Board board;
     board_init(&board);
@@ -118,6 +244,7 @@ UTEST(ai, thread) {
     task_hard.board_copy = board;
     task_hard.ai_player = ai_player;
     task_hard.ai_level = AI_HARD;
+    task_hard.context = NULL;
     task_hard.result = -1;
 
     ai_thread_function(&task_hard);
@@ -130,6 +257,7 @@ UTEST(ai, thread) {
     task_expert.board_copy = board;
     task_expert.ai_player = ai_player;
     task_expert.ai_level = AI_EXPERT;
+    task_expert.context = NULL;
     task_expert.result = -1;
 
     ai_thread_function(&task_expert);
@@ -139,4 +267,177 @@ UTEST(ai, thread) {
     ASSERT_TRUE(board_is_valid_move(&board, task_expert.result) == 1);
 }
 
+UTEST(ai, search_stats) {
+    Board board;
+    board_init(&board);
+    board_drop_piece(&board, 3, PLAYER1);
+
+    SearchResult result;
+    int column = ai_search(&board, PLAYER2, AI_EXPERT, &result);
+
+    ASSERT_EQ(column, result.column);
+    ASSERT_TRUE(board_is_valid_move(&board, column) == 1);
+    ASSERT_TRUE(result.stats.nodes > 0);
+    ASSERT_TRUE(result.stats.leaf_evaluations > 0);
+    ASSERT_TRUE(result.stats.leaf_evaluations <= result.stats.nodes);
+    ASSERT_TRUE(result.stats.max_depth >= 2);
+
+    // the search itself is deterministic, so are its counters
+    SearchResult again;
+    ai_search(&board, PLAYER2, AI_EXPERT, &again);
+    ASSERT_EQ(result.column, again.column);
+    ASSERT_TRUE(result.stats.nodes == again.stats.nodes);
+}
+
+UTEST(ai, variant_board) {
+    BoardConfig config;
+    Board board;
+    CellState to_move;
+
+    // connect 5 on 9x6: X holds columns 6-9 of the bottom row and completes it in column 5
+    ASSERT_EQ(board_config_parse("9x6:5", &config), 1);
+    ASSERT_EQ(board_play_moves_config(&board, &config, "66778891", &to_move), 8);
+    ASSERT_EQ(to_move, PLAYER1);
+
+    ASSERT_EQ(ai_hard(&board, PLAYER1), 4);
+    ASSERT_EQ(ai_expert(&board, PLAYER1), 4);
+    // no solver for this size, the perfect level searches with iterative deepening
+    ASSERT_EQ(ai_search(&board, PLAYER1, AI_PERFECT, NULL), 4);
+    ASSERT_EQ(ai_expert(&board, PLAYER2), 4);
+}
+
+UTEST(ai, ponder) {
+    Board board;
+    CellState to_move;
+    Ponder ponder;
+
+    // X to move in a middle game position the solver finishes quickly
+    ASSERT_EQ(board_play_moves(&board, "6621111776323461773375227463", &to_move), 28);
+    ai_ponder_init(&ponder);
+
+    // the expert level does not ponder
+    ASSERT_EQ(ai_ponder_start(&ponder, &board, PLAYER2, AI_EXPERT), 0);
+
+    ASSERT_EQ(ai_ponder_start(&ponder, &board, PLAYER2, AI_PERFECT), 1);
+    ai_ponder_wait(&ponder);
+
+    // every reply was solved in the background, the answer costs no search
+    for (int col = 0; col < board.cols; col++) {
+        Board next = board;
+        if (board_drop_piece(&next, col, to_move) < 0 || board_check_winner(&next, to_move)) {
+            continue;
+        }
+        SearchResult pondered;
+        ai_search(&next, PLAYER2, AI_PERFECT, &pondered);
+        ASSERT_TRUE(pondered.stats.nodes == 0);
+
+        Solver solver;
+        Position position;
+        ASSERT_EQ(solver_init(&solver, 20), 1);
+        solver_position_from_board(&position, &next, PLAYER2);
+        ASSERT_EQ(pondered.column, solver_best_move(&solver, &position, NULL));
+        solver_free(&solver);
+    }
+
+    // a position that was not pondered is searched as usual
+    SearchResult searched;
+    ai_search(&board, PLAYER1, AI_PERFECT, &searched);
+    ASSERT_TRUE(searched.stats.nodes > 0);
+
+    // stopping cancels a running ponder
+    ASSERT_EQ(board_play_moves(&board, "44", &to_move), 2);
+    ASSERT_EQ(ai_ponder_start(&ponder, &board, PLAYER2, AI_PERFECT), 1);
+    ai_ponder_stop(&ponder);
+    ASSERT_EQ(ponder.running, 0);
+}
+
+UTEST(ai, ponder_full_columns) {
+    Board board;
+    CellState to_move;
+    Ponder ponder;
+
+    // X to move, column 3 is full and column 7 has its top cell left
+    ASSERT_EQ(board_play_moves(&board, "1537336254132275652772343147", &to_move), 28);
+    ASSERT_EQ(board_is_valid_move(&board, 2), 0);
+    ai_ponder_init(&ponder);
+    ASSERT_EQ(ai_ponder_start(&ponder, &board, PLAYER2, AI_PERFECT), 1);
+    ai_ponder_wait(&ponder);
+
+    // the reply into the top row was pondered like the others
+    Board next = board;
+    ASSERT_EQ(board_drop_piece(&next, 6, to_move), 0);
+    SearchResult pondered;
+    ai_search(&next, PLAYER2, AI_PERFECT, &pondered);
+    ASSERT_TRUE(pondered.stats.nodes == 0);
+
+    // the full column added nothing: the unchanged board was not solved for the AI
+    SearchResult searched;
+    ai_search(&board, PLAYER2, AI_PERFECT, &searched);
+    ASSERT_TRUE(searched.stats.nodes > 0);
+}
+
+typedef struct {
+    int count;
+    int depths[64];
+    int column;
+} ProgressLog;
+
+static void log_progress(const SearchProgress *progress, void *user) {
+    ProgressLog *log = (ProgressLog *)user;
+    if (log->count < 64) {
+        log->depths[log->count] = progress->depth;
+    }
+    log->count = log->count + 1;
+    log->column = progress->column;
+}
+
+UTEST(ai, search_context) {
+    Board board;
+    CellState to_move;
+    SearchContext context;
+    SearchResult result;
+    ProgressLog log = {0};
+
+    // an exact result is one report, as deep as the game goes
+    ASSERT_EQ(board_play_moves(&board, "6621111776323461773375227463", &to_move), 28);
+    ai_context_init(&context);
+    context.progress = log_progress;
+    context.user = &log;
+    int column = ai_search_context(&board, to_move, AI_PERFECT, &context, &result);
+    ASSERT_EQ(log.count, 1);
+    ASSERT_EQ(log.depths[0], 42 - 28);
+    ASSERT_EQ(log.column, column);
+
+    // too early to solve: iterative deepening reports every depth until the deadline
+    ASSERT_EQ(board_play_moves(&board, "", &to_move), 0);
+    log.count = 0;
+    ai_context_set_time_limit(&context, 100000000ULL);
+    column = ai_search_context(&board, to_move, AI_PERFECT, &context, &result);
+    ASSERT_TRUE(log.count >= 1);
+    for (int i = 0; i < log.count && i < 64; i++) {
+        ASSERT_EQ(log.depths[i], i + 1);
+    }
+    ASSERT_EQ(log.column, column);
+    ASSERT_TRUE(result.stats.elapsed_ns < 1000000000ULL);
+
+    // the principal variation starts with the move and can be played out
+    ASSERT_TRUE(result.pv.length >= 1);
+    ASSERT_EQ(result.pv.moves[0], column);
+    Board line = board;
+    CellState player = to_move;
+    for (int i = 0; i < result.pv.length; i++) {
+        ASSERT_TRUE(board_drop_piece(&line, result.pv.moves[i], player) >= 0);
+        player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+
+    // a stopped search still plays a legal move
+    ai_context_init(&context);
+    ai_context_stop(&context);
+    ASSERT_TRUE(ai_context_expired(&context) == 1);
+    column = ai_search_context(&board, to_move, AI_PERFECT, &context, &result);
+    ASSERT_TRUE(board_is_valid_move(&board, column) == 1);
+    column = ai_search_context(&board, to_move, AI_MCTS, &context, &result);
+    ASSERT_TRUE(board_is_valid_move(&board, column) == 1);
+}
+
 UTEST_MAIN()
@@ -0,0 +1,139 @@
+#include "utest.h"
+#include "archive.h"
+#include "board.h"
+#include "history.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ARCHIVE "test_archive.c4a"
+#define TEST_INDEX "test_archive.c4a.idx"
+
+static void add_columns(Move **head, const int *cols, int count) {
+    Board board;
+    CellState player = PLAYER1;
+
+    board_init(&board);
+    for (int i = 0; i < count; i++) {
+        int row = board_drop_piece(&board, cols[i], player);
+        history_add_move(head, row, cols[i], player);
+        player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    }
+}
+
+UTEST(archive, append_and_replay) {
+    const int game1[] = {3, 3, 4, 4, 5, 5, 6};
+    const int game2[] = {0, 1, 0, 1, 0, 1, 2, 1};
+    Move *first = NULL;
+    Move *second = NULL;
+
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+
+    add_columns(&first, game1, 7);
+    add_columns(&second, game2, 8);
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, first), 1);
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, second), 1);
+
+    GameArchive archive;
+    ASSERT_EQ(archive_open(&archive, TEST_ARCHIVE), 1);
+    ASSERT_EQ((int)archive_game_count(&archive), 2);
+    ASSERT_EQ(archive_game_length(&archive, 1), 8);
+    ASSERT_EQ(archive_game_length(&archive, 2), -1);
+
+    Board expected;
+    Board replayed;
+    board_init(&expected);
+    history_replay(second, &expected);
+    ASSERT_EQ(archive_replay(&archive, 1, &replayed), 1);
+    ASSERT_EQ(memcmp(&expected, &replayed, sizeof(Board)), 0);
+    ASSERT_EQ(board_check_winner(&replayed, PLAYER2), 1);
+
+    Move *loaded = NULL;
+    ASSERT_EQ(archive_load_moves(&archive, 0, &loaded), 1);
+    const Move *a = first;
+    const Move *b = loaded;
+    while (a != NULL && b != NULL) {
+        ASSERT_EQ(a->row, b->row);
+        ASSERT_EQ(a->col, b->col);
+        ASSERT_EQ((int)a->player, (int)b->player);
+        a = a->next;
+        b = b->next;
+    }
+    ASSERT_TRUE(a == NULL && b == NULL);
+
+    archive_close(&archive);
+    history_free(&loaded);
+    history_free(&first);
+    history_free(&second);
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+}
+
+// Games appended after the index was written are picked up on the next open
+UTEST(archive, index_extended_after_append) {
+    const int game[] = {3, 2, 3, 2, 3, 2, 3};
+    Move *moves = NULL;
+    GameArchive archive;
+
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+
+    add_columns(&moves, game, 7);
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, moves), 1);
+    ASSERT_EQ(archive_open(&archive, TEST_ARCHIVE), 1);
+    ASSERT_EQ((int)archive_game_count(&archive), 1);
+    archive_close(&archive);
+
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, moves), 1);
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, NULL), 1);
+    ASSERT_EQ(archive_open(&archive, TEST_ARCHIVE), 1);
+    ASSERT_EQ((int)archive_game_count(&archive), 3);
+    ASSERT_EQ(archive_game_length(&archive, 2), 0);
+
+    Board board;
+    ASSERT_EQ(archive_replay(&archive, 1, &board), 1);
+    ASSERT_EQ(board_check_winner(&board, PLAYER1), 1);
+    archive_close(&archive);
+
+    history_free(&moves);
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+}
+
+UTEST(archive, variant_geometry) {
+    BoardConfig config;
+    Move *moves = NULL;
+    GameArchive archive;
+    Board board;
+
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+
+    // connect 5 on 9x6, the winning row reaches the ninth column
+    const char *game = "556677889";
+    ASSERT_EQ(board_config_parse("9x6:5", &config), 1);
+    ASSERT_EQ(board_play_moves_config(&board, &config, game, NULL), 9);
+    for (int i = 0; game[i] != '\0'; i++) {
+        history_add_move(&moves, 0, game[i] - '1', (i % 2 == 0) ? PLAYER1 : PLAYER2);
+    }
+
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &config, moves), 1);
+    // games of another geometry do not go into the same file
+    ASSERT_EQ(archive_append_game(TEST_ARCHIVE, &BOARD_STANDARD, moves), 0);
+
+    ASSERT_EQ(archive_open(&archive, TEST_ARCHIVE), 1);
+    ASSERT_EQ((int)archive_game_count(&archive), 1);
+    ASSERT_EQ(archive.config.cols, 9);
+    ASSERT_EQ(archive.config.rows, 6);
+    ASSERT_EQ(archive.config.connect, 5);
+
+    Board replayed;
+    ASSERT_EQ(archive_replay(&archive, 0, &replayed), 1);
+    ASSERT_EQ(memcmp(&board, &replayed, sizeof(Board)), 0);
+    ASSERT_EQ(board_check_winner(&replayed, PLAYER1), 1);
+    archive_close(&archive);
+
+    history_free(&moves);
+    remove(TEST_ARCHIVE);
+    remove(TEST_INDEX);
+}
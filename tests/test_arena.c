@@ -0,0 +1,97 @@
+#include "utest.h"
+#include "arena.h"
+#include "history.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+UTEST(arena, alloc_and_alignment) {
+    Arena arena;
+    arena_init(&arena, 256);
+
+    unsigned char *a = (unsigned char *)arena_alloc(&arena, 3);
+    unsigned char *b = (unsigned char *)arena_alloc(&arena, 40);
+    ASSERT_TRUE(a != NULL && b != NULL);
+    ASSERT_EQ((uintptr_t)a % ARENA_ALIGNMENT, 0u);
+    ASSERT_EQ((uintptr_t)b % ARENA_ALIGNMENT, 0u);
+    ASSERT_TRUE(b >= a + 3);
+    memset(a, 1, 3);
+    memset(b, 2, 40);
+    ASSERT_EQ(a[2], 1);
+
+    // larger than a block: a block of its own
+    unsigned char *big = (unsigned char *)arena_alloc(&arena, 1000);
+    ASSERT_TRUE(big != NULL);
+    memset(big, 3, 1000);
+    ASSERT_EQ(b[39], 2);
+    ASSERT_TRUE(arena_capacity(&arena) >= 1256u);
+
+    arena_free(&arena);
+    ASSERT_EQ(arena_capacity(&arena), 0u);
+}
+
+UTEST(arena, mark_rewind_reset) {
+    Arena arena;
+    arena_init(&arena, 256);
+
+    void *first = arena_alloc(&arena, 64);
+    ArenaMark mark = arena_mark(&arena);
+    void *second = arena_alloc(&arena, 64);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(arena_alloc(&arena, 100) != NULL);
+    }
+    size_t capacity = arena_capacity(&arena);
+
+    // the same memory comes back, no new blocks
+    arena_rewind(&arena, mark);
+    ASSERT_TRUE(arena_alloc(&arena, 64) == second);
+    for (int i = 0; i < 20; i++) {
+        ASSERT_TRUE(arena_alloc(&arena, 100) != NULL);
+    }
+    ASSERT_EQ(arena_capacity(&arena), capacity);
+
+    arena_reset(&arena);
+    ASSERT_TRUE(arena_alloc(&arena, 64) == first);
+    ASSERT_EQ(arena_capacity(&arena), capacity);
+
+    arena_free(&arena);
+}
+
+static void *thread_arena(void *arg) {
+    Arena **out = (Arena **)arg;
+    out[0] = arena_thread();
+    out[1] = arena_thread();
+    return NULL;
+}
+
+UTEST(arena, per_thread) {
+    Arena *other[2];
+    pthread_t thread;
+
+    ASSERT_TRUE(arena_thread() != NULL);
+    ASSERT_TRUE(arena_thread() == arena_thread());
+    ASSERT_EQ(pthread_create(&thread, NULL, thread_arena, other), 0);
+    pthread_join(thread, NULL);
+    ASSERT_TRUE(other[0] == other[1]);
+    ASSERT_TRUE(other[0] != arena_thread());
+}
+
+// freed history nodes are handed out again instead of growing the arena
+UTEST(arena, history_reuses_nodes) {
+    Move *head = NULL;
+
+    for (int i = 0; i < 42; i++) {
+        history_add_move(&head, 0, i % COLS, PLAYER1);
+    }
+    history_free(&head);
+    size_t capacity = arena_capacity(arena_thread());
+
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 42; i++) {
+            history_add_move(&head, 0, i % COLS, PLAYER2);
+        }
+        history_free(&head);
+    }
+    ASSERT_EQ(arena_capacity(arena_thread()), capacity);
+    ASSERT_TRUE(head == NULL);
+}
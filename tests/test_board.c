@@ -66,10 +66,10 @@ UTEST(board, diagonal_down_right_win) {
 	Board b;
 	board_init(&b);
 	// create diagonal starting at (2,0) -> (5,3)
-	b.cells[2][0] = PLAYER1;
-	b.cells[3][1] = PLAYER1;
-	b.cells[4][2] = PLAYER1;
-	b.cells[5][3] = PLAYER1;
+	board_set_cell(&b, 2, 0, PLAYER1);
+	board_set_cell(&b, 3, 1, PLAYER1);
+	board_set_cell(&b, 4, 2, PLAYER1);
+	board_set_cell(&b, 5, 3, PLAYER1);
 	ASSERT_EQ(board_check_winner(&b, PLAYER1), 1);
 }
 
@@ -78,11 +78,225 @@ UTEST(board, diagonal_down_left_win) {
 	Board b;
 	board_init(&b);
 	// create diagonal starting at (2,3) -> (5,0)
-	b.cells[2][3] = PLAYER2;
-	b.cells[3][2] = PLAYER2;
-	b.cells[4][1] = PLAYER2;
-	b.cells[5][0] = PLAYER2;
+	board_set_cell(&b, 2, 3, PLAYER2);
+	board_set_cell(&b, 3, 2, PLAYER2);
+	board_set_cell(&b, 4, 1, PLAYER2);
+	board_set_cell(&b, 5, 0, PLAYER2);
 	ASSERT_EQ(board_check_winner(&b, PLAYER2), 1);
 }
 
+// Move strings use 1-based columns and alternate players starting with PLAYER1
+UTEST(board, play_moves) {
+	Board b;
+	CellState next;
+	ASSERT_EQ(board_play_moves(&b, "4453", &next), 4);
+	ASSERT_EQ(b.cells[ROWS - 1][3], PLAYER1);
+	ASSERT_EQ(b.cells[ROWS - 2][3], PLAYER2);
+	ASSERT_EQ(b.cells[ROWS - 1][4], PLAYER1);
+	ASSERT_EQ(b.cells[ROWS - 1][2], PLAYER2);
+	ASSERT_EQ(next, PLAYER1);
+
+	ASSERT_EQ(board_play_moves(&b, "", &next), 0);
+	ASSERT_EQ(next, PLAYER1);
+
+	// invalid column, overflowing column, move after a win
+	ASSERT_EQ(board_play_moves(&b, "48", NULL), -1);
+	ASSERT_EQ(board_play_moves(&b, "1111111", NULL), -1);
+	ASSERT_EQ(board_play_moves(&b, "12121213", NULL), -1);
+	ASSERT_EQ(board_play_moves(&b, "1212121", &next), 7);
+	ASSERT_EQ(board_check_winner(&b, PLAYER1), 1);
+}
+
+// Reference leaf counts from the empty board (checked against an independent implementation).
+// Lines stop on a win, so counts drop below 7^n once columns fill up and fours appear.
+UTEST(board, perft) {
+	static const unsigned long long expected[] = {
+		1ULL, 7ULL, 49ULL, 343ULL, 2401ULL, 16807ULL, 117649ULL, 823536ULL, 5686266ULL
+	};
+	Board b;
+	board_init(&b);
+	for (int depth = 0; depth <= 8; ++depth) {
+		ASSERT_TRUE(board_perft(&b, PLAYER1, depth) == expected[depth]);
+	}
+	// perft must leave the caller's board untouched
+	ASSERT_EQ(board_is_full(&b), 0);
+	ASSERT_EQ(b.cells[ROWS - 1][0], EMPTY);
+}
 
+UTEST(board, variant_geometry) {
+	BoardConfig config;
+	Board b;
+
+	ASSERT_EQ(board_config_parse("9x6:5", &config), 1);
+	ASSERT_EQ(config.cols, 9);
+	ASSERT_EQ(config.rows, 6);
+	ASSERT_EQ(config.connect, 5);
+	ASSERT_EQ(board_config_parse("8x7", &config), 1);
+	ASSERT_EQ(config.connect, 4);
+	ASSERT_EQ(board_config_parse("10x6", &config), 0);
+	ASSERT_EQ(board_config_parse("7x6:7", &config), 0);
+	ASSERT_EQ(board_config_parse("7x", &config), 0);
+	ASSERT_EQ(board_config_parse("7x6:5x", &config), 0);
+
+	// connect 5: four stacked stones are not enough, the fifth wins
+	ASSERT_EQ(board_config_parse("9x6:5", &config), 1);
+	ASSERT_EQ(board_play_moves_config(&b, &config, "1212121", NULL), 7);
+	ASSERT_EQ(board_check_winner(&b, PLAYER1), 0);
+	ASSERT_EQ(board_play_moves_config(&b, &config, "121212121", NULL), 9);
+	ASSERT_EQ(board_check_winner(&b, PLAYER1), 1);
+	ASSERT_EQ(board_play_moves_config(&b, &config, "556677889", NULL), 9);
+	ASSERT_EQ(board_check_winner(&b, PLAYER1), 1);
+	ASSERT_EQ(board_drop_piece(&b, 8, PLAYER2), 4);
+
+	// the generic win check covers sizes without a fast path
+	config.cols = 6;
+	config.rows = 5;
+	config.connect = 4;
+	ASSERT_EQ(board_play_moves_config(&b, &config, "1212121", NULL), 7);
+	ASSERT_EQ(board_check_winner(&b, PLAYER1), 1);
+	ASSERT_EQ(board_play_moves_config(&b, &config, "7", NULL), -1);
+
+	// no line of four fits in three plies, so every line is a leaf
+	ASSERT_EQ(board_config_parse("9x7", &config), 1);
+	board_init_config(&b, &config);
+	ASSERT_TRUE(board_perft(&b, PLAYER1, 3) == 729ULL);
+}
+
+// Cell by cell reference for the bitboard kernels
+static int line_from(const Board *b, CellState player, int row, int col, int dr, int dc) {
+	for (int k = 0; k < b->connect; k++) {
+		int r = row + k * dr;
+		int c = col + k * dc;
+		if (r < 0 || r >= b->rows || c < 0 || c >= b->cols || b->cells[r][c] != player) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int slow_has_line(const Board *b, CellState player) {
+	for (int row = 0; row < b->rows; row++) {
+		for (int col = 0; col < b->cols; col++) {
+			if (line_from(b, player, row, col, 0, 1) || line_from(b, player, row, col, 1, 0) ||
+				line_from(b, player, row, col, 1, 1) || line_from(b, player, row, col, 1, -1)) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+// Specialized and generic kernels agree with a cell scan on random positions
+UTEST(board, bitboard_kernels) {
+	static const char *geometries[] = {"7x6", "8x7", "9x7", "9x6:5", "5x4", "6x5:5", "8x8:6"};
+	unsigned int seed = 12345;
+	BoardConfig config;
+	Board b;
+
+	ASSERT_EQ(board_config_parse("9x8", &config), 0);
+
+	for (size_t g = 0; g < sizeof(geometries) / sizeof(geometries[0]); g++) {
+		ASSERT_EQ(board_config_parse(geometries[g], &config), 1);
+		for (int game = 0; game < 200; game++) {
+			board_init_config(&b, &config);
+			CellState player = PLAYER1;
+			for (int ply = 0; ply < config.rows * config.cols; ply++) {
+				seed = seed * 1103515245u + 12345u;
+				int col = (int)((seed >> 16) % (unsigned int)config.cols);
+				if (board_drop_piece(&b, col, player) < 0) {
+					continue;
+				}
+
+				ASSERT_EQ(board_check_winner(&b, PLAYER1), slow_has_line(&b, PLAYER1));
+				ASSERT_EQ(board_check_winner(&b, PLAYER2), slow_has_line(&b, PLAYER2));
+				if (board_check_winner(&b, player)) {
+					break;
+				}
+
+				for (int p = PLAYER1; p <= PLAYER2; p++) {
+					// an empty cell is a threat exactly when filling it makes a line
+					Bitboard threats = board_winning_cells(&b, (CellState)p);
+					for (int row = 0; row < b.rows; row++) {
+						for (int c = 0; c < b.cols; c++) {
+							if (b.cells[row][c] != EMPTY) {
+								ASSERT_EQ((threats & board_cell_bit(&b, row, c)) != 0, 0);
+								continue;
+							}
+							Board filled = b;
+							board_set_cell(&filled, row, c, (CellState)p);
+							int expected = slow_has_line(&filled, (CellState)p);
+							ASSERT_EQ((threats & board_cell_bit(&b, row, c)) != 0, expected);
+						}
+					}
+				}
+
+				Bitboard playable = board_playable_cells(&b);
+				for (int c = 0; c < b.cols; c++) {
+					int row = b.rows - 1;
+					while (row >= 0 && b.cells[row][c] != EMPTY) row--;
+					for (int r = 0; r < b.rows; r++) {
+						ASSERT_EQ((playable & board_cell_bit(&b, r, c)) != 0, r == row);
+					}
+				}
+
+				player = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+			}
+		}
+	}
+}
+
+// Every batch kernel the CPU has agrees with a cell scan, across runs of mixed geometries
+UTEST(board, check_winner_batch) {
+	static const char *geometries[] = {"7x6", "9x6:5", "5x4", "8x8:6", "7x6"};
+	static const char *kernels[] = {"avx2", "sse2", "scalar"};
+	static Board boards[5 * 41];
+	CellState out[5 * 41];
+	unsigned char lines[5 * 41];
+	Bitboard stones[5 * 41];
+	unsigned int seed = 777;
+	const char *original = board_batch_kernel();
+	int count = 0;
+
+	for (size_t g = 0; g < sizeof(geometries) / sizeof(geometries[0]); g++) {
+		BoardConfig config;
+		ASSERT_EQ(board_config_parse(geometries[g], &config), 1);
+		for (int i = 0; i < 41; i++) {
+			Board *b = &boards[count++];
+			board_init_config(b, &config);
+			// random cells, gravity aside, so both players often have lines
+			for (int row = 0; row < config.rows; row++) {
+				for (int col = 0; col < config.cols; col++) {
+					seed = seed * 1103515245u + 12345u;
+					int pick = (int)((seed >> 16) % 5u);
+					board_set_cell(b, row, col, pick < 2 ? PLAYER1 : (pick < 4 ? PLAYER2 : EMPTY));
+				}
+			}
+		}
+	}
+
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		if (!board_batch_select(kernels[k])) {
+			continue;
+		}
+		ASSERT_STREQ(board_batch_kernel(), kernels[k]);
+
+		board_check_winner_batch(boards, count, out);
+		for (int i = 0; i < count; i++) {
+			CellState expected = slow_has_line(&boards[i], PLAYER1) ? PLAYER1 :
+			                     (slow_has_line(&boards[i], PLAYER2) ? PLAYER2 : EMPTY);
+			ASSERT_EQ(out[i], expected);
+		}
+
+		// odd counts leave a tail for the narrower kernels
+		for (int i = 0; i < 41; i++) {
+			stones[i] = boards[41 + i].stones[1];
+		}
+		board_has_line_batch(&boards[41], stones, 39, lines);
+		for (int i = 0; i < 39; i++) {
+			ASSERT_EQ(lines[i], slow_has_line(&boards[41 + i], PLAYER2));
+		}
+	}
+
+	ASSERT_EQ(board_batch_select(original), 1);
+	ASSERT_EQ(board_batch_select("neon"), 0);
+}
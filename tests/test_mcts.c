@@ -0,0 +1,97 @@
+#include "utest.h"
+#include "mcts.h"
+#include "board.h"
+
+static void small_config(MctsConfig *config, int threads) {
+    mcts_default_config(config);
+    config->threads = threads;
+    config->playouts = 3000;
+    config->pool_nodes = 1u << 15;
+}
+
+UTEST(mcts, finds_win_and_block) {
+    MctsConfig config;
+    MctsEngine engine;
+    Board board;
+    CellState to_move;
+
+    small_config(&config, 1);
+    ASSERT_EQ(mcts_init(&engine, &config), 1);
+
+    // X completes the bottom row in column 4 (0-based 3)
+    ASSERT_EQ(board_play_moves(&board, "17273", &to_move), 5);
+    ASSERT_EQ(mcts_best_move(&engine, &board, PLAYER2, NULL), 3);
+    ASSERT_EQ(mcts_best_move(&engine, &board, PLAYER1, NULL), 3);
+
+    mcts_free(&engine);
+}
+
+UTEST(mcts, deterministic_and_parallel) {
+    MctsConfig config;
+    MctsEngine a;
+    MctsEngine b;
+    Board board;
+    CellState to_move;
+    SearchStats stats_a = {0};
+    SearchStats stats_b = {0};
+
+    small_config(&config, 3);
+    ASSERT_EQ(mcts_init(&a, &config), 1);
+    ASSERT_EQ(mcts_init(&b, &config), 1);
+    ASSERT_EQ(board_play_moves(&board, "4453", &to_move), 4);
+
+    int column = mcts_best_move(&a, &board, to_move, &stats_a);
+    ASSERT_EQ(mcts_best_move(&b, &board, to_move, &stats_b), column);
+    ASSERT_TRUE(board_is_valid_move(&board, column) == 1);
+    ASSERT_TRUE(stats_a.nodes == stats_b.nodes);
+    ASSERT_TRUE(stats_a.leaf_evaluations == 3 * config.playouts);
+
+    mcts_free(&a);
+    mcts_free(&b);
+}
+
+UTEST(mcts, tree_reuse) {
+    MctsConfig config;
+    MctsEngine engine;
+    Board board;
+    CellState to_move;
+
+    small_config(&config, 1);
+    ASSERT_EQ(mcts_init(&engine, &config), 1);
+    ASSERT_EQ(board_play_moves(&board, "44", &to_move), 2);
+
+    int column = mcts_best_move(&engine, &board, to_move, NULL);
+    board_drop_piece(&board, column, to_move);
+    board_drop_piece(&board, column, to_move == PLAYER1 ? PLAYER2 : PLAYER1);
+
+    // two moves later the old grandchild is the root, with its visits
+    mcts_best_move(&engine, &board, to_move, NULL);
+    const MctsTree *tree = &engine.trees[0];
+    ASSERT_EQ(tree->root, 0u);
+    ASSERT_TRUE(tree->nodes[tree->root].visits > config.playouts);
+
+    // an unrelated position starts over
+    ASSERT_EQ(board_play_moves(&board, "1", &to_move), 1);
+    mcts_best_move(&engine, &board, to_move, NULL);
+    ASSERT_EQ(tree->nodes[tree->root].visits, config.playouts);
+
+    mcts_free(&engine);
+}
+
+UTEST(mcts, small_pool_and_variant_board) {
+    MctsConfig config;
+    MctsEngine engine;
+    BoardConfig geometry;
+    Board board;
+    CellState to_move;
+
+    // a full pool only stops the tree from growing
+    small_config(&config, 1);
+    config.pool_nodes = 64;
+    ASSERT_EQ(mcts_init(&engine, &config), 1);
+    ASSERT_EQ(board_config_parse("9x6:5", &geometry), 1);
+    ASSERT_EQ(board_play_moves_config(&board, &geometry, "66778891", &to_move), 8);
+    ASSERT_EQ(mcts_best_move(&engine, &board, to_move, NULL), 4);
+    ASSERT_TRUE(engine.trees[0].used <= 64u);
+    mcts_free(&engine);
+}
@@ -0,0 +1,62 @@
+#include "utest.h"
+#include "rng.h"
+#include <stdint.h>
+#include <pthread.h>
+
+UTEST(rng, seeded_sequences) {
+    Rng a;
+    Rng b;
+    Rng zero;
+
+    rng_seed(&a, 42);
+    rng_seed(&b, 42);
+    rng_seed(&zero, 0);
+    ASSERT_NE(zero.state, (uint64_t)0);
+
+    int differ = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t x = rng_next(&a);
+        ASSERT_EQ(x, rng_next(&b));
+        differ += (x != rng_next(&zero));
+    }
+    ASSERT_TRUE(differ > 990);
+
+    // every value of a small range comes up, nothing outside it
+    int seen[7] = {0};
+    for (int i = 0; i < 7000; i++) {
+        uint32_t value = rng_below(&a, 7);
+        ASSERT_TRUE(value < 7u);
+        seen[value]++;
+    }
+    for (int value = 0; value < 7; value++) {
+        ASSERT_TRUE(seen[value] > 700);
+    }
+}
+
+static void *draw_thread_numbers(void *arg) {
+    uint64_t *out = (uint64_t *)arg;
+    for (int i = 0; i < 8; i++) {
+        out[i] = rng_next(rng_thread());
+    }
+    return NULL;
+}
+
+UTEST(rng, thread_generators) {
+    uint64_t first[8];
+    uint64_t second[8];
+    pthread_t thread;
+
+    // a fresh thread starts from the default seed, whatever other threads drew
+    rng_next(rng_thread());
+    ASSERT_EQ(pthread_create(&thread, NULL, draw_thread_numbers, first), 0);
+    pthread_join(thread, NULL);
+    ASSERT_EQ(pthread_create(&thread, NULL, draw_thread_numbers, second), 0);
+    pthread_join(thread, NULL);
+
+    Rng expected;
+    rng_seed(&expected, RNG_DEFAULT_SEED);
+    for (int i = 0; i < 8; i++) {
+        ASSERT_EQ(first[i], second[i]);
+        ASSERT_EQ(first[i], rng_next(&expected));
+    }
+}
@@ -0,0 +1,207 @@
+#include "utest.h"
+#include "solver.h"
+#include "board.h"
+#include "ai.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef CONNECT4_TEST_DATA
+#define CONNECT4_TEST_DATA "data"
+#endif
+
+static int solve_moves(Solver *solver, const char *moves, int *score) {
+    Board board;
+    CellState to_move;
+    Position position;
+
+    if (board_play_moves(&board, moves, &to_move) < 0) {
+        return 0;
+    }
+    solver_position_from_board(&position, &board, to_move);
+    return solver_solve(solver, &position, score);
+}
+
+// Scores cross-checked with a plain minimax over the full game tree
+UTEST(solver, known_scores) {
+    Solver solver;
+    int score;
+
+    ASSERT_EQ(solver_init(&solver, 18), 1);
+
+    ASSERT_EQ(solve_moves(&solver, "2252576253462244111563365343671351441", &score), 1);
+    ASSERT_EQ(score, -1);
+    ASSERT_EQ(solve_moves(&solver, "7422341735647741166133573473242566", &score), 1);
+    ASSERT_EQ(score, 1);
+    ASSERT_EQ(solve_moves(&solver, "23163416124767223154467471272416755633", &score), 1);
+    ASSERT_EQ(score, 0);
+    ASSERT_EQ(solve_moves(&solver, "65214673556155731566316327373221417", &score), 1);
+    ASSERT_EQ(score, -1);
+
+    solver_free(&solver);
+}
+
+// Exact score by alpha-beta over the whole game tree, on the board routines
+// alone: no table, no move ordering, nothing shared with the solver
+static int minimax_score(const Board *board, CellState player, int alpha, int beta) {
+    CellState other = (player == PLAYER1) ? PLAYER2 : PLAYER1;
+    int moves = 0;
+
+    for (int col = 0; col < board->cols; col++) {
+        Board child = *board;
+        if (board_drop_piece(&child, col, player) >= 0 && board_check_winner(&child, player)) {
+            return 22 - __builtin_popcountll(child.stones[player - PLAYER1]);
+        }
+    }
+    for (int col = 0; col < board->cols && alpha < beta; col++) {
+        Board child = *board;
+        if (board_drop_piece(&child, col, player) < 0) {
+            continue;
+        }
+        moves = moves + 1;
+        int score = -minimax_score(&child, other, -beta, -alpha);
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+    return (moves == 0) ? 0 : alpha;
+}
+
+// Checks the scores of a reference set against the minimax, positions with at
+// most `max_empty` empty cells; returns how many were checked, -1 on a mismatch
+static int check_reference_set(const char *name, int max_empty) {
+    char path[512];
+    char line[256];
+    int checked = 0;
+
+    snprintf(path, sizeof(path), "%s/%s.txt", CONNECT4_TEST_DATA, name);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        char moves[128];
+        int expected;
+        Board board;
+        CellState to_move;
+
+        if (sscanf(line, "%127s %d", moves, &expected) != 2 || ROWS * COLS - (int)strlen(moves) > max_empty) {
+            continue;
+        }
+        if (board_play_moves(&board, moves, &to_move) < 0 ||
+            minimax_score(&board, to_move, -ROWS * COLS, ROWS * COLS) != expected) {
+            fprintf(stderr, "%s: %s does not score %d\n", path, moves, expected);
+            fclose(file);
+            return -1;
+        }
+        checked = checked + 1;
+    }
+    fclose(file);
+    return checked;
+}
+
+// The set files were written by this solver; a separate search keeps them honest
+UTEST(solver, reference_sets_match_minimax) {
+    ASSERT_EQ(check_reference_set("end_easy", ROWS * COLS), 100);
+    ASSERT_EQ(check_reference_set("middle_easy", 18), 26);
+}
+
+UTEST(solver, best_move_takes_win) {
+    Solver solver;
+    Board board;
+    CellState to_move;
+    Position position;
+    int score;
+
+    ASSERT_EQ(solver_init(&solver, 18), 1);
+
+    // PLAYER1 has three on the bottom row and wins in column 4 (0-based 3) right away
+    ASSERT_EQ(board_play_moves(&board, "112233", &to_move), 6);
+    solver_position_from_board(&position, &board, to_move);
+    ASSERT_EQ(solver_best_move(&solver, &position, &score), 3);
+    ASSERT_EQ(score, 18);
+
+    solver_free(&solver);
+}
+
+UTEST(solver, node_limit) {
+    Solver solver;
+    int score;
+
+    ASSERT_EQ(solver_init(&solver, 18), 1);
+
+    // an opening position needs far more than 1000 nodes
+    solver.node_limit = 1000;
+    ASSERT_EQ(solve_moves(&solver, "44", &score), 0);
+    ASSERT_EQ(solver.aborted, 1);
+
+    solver_free(&solver);
+}
+
+UTEST(solver, replacement_schemes) {
+    static const TableReplacement schemes[3] = {TABLE_ALWAYS_REPLACE, TABLE_DEPTH_PREFERRED, TABLE_TWO_TIER};
+    TableReplacement parsed;
+    TranspositionTable table;
+    Solver solver;
+    SearchStats stats = {0};
+    int score;
+
+    ASSERT_EQ(solver_parse_replacement("two-tier", &parsed), 1);
+    ASSERT_EQ(parsed, TABLE_TWO_TIER);
+    ASSERT_EQ(solver_parse_replacement("lru", &parsed), 0);
+
+    // the smallest table overflows, which may cost nodes but never the score
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(solver_table_init(&table, 18, schemes[i]), 1);
+        solver_init_shared(&solver, &table);
+        solver.stats = &stats;
+        ASSERT_EQ(solve_moves(&solver, "2266661263422571", &score), 1);
+        ASSERT_EQ(score, -2);
+        ASSERT_EQ(solve_moves(&solver, "57163114336634611373", &score), 1);
+        ASSERT_EQ(score, 3);
+        solver_table_free(&table);
+    }
+    ASSERT_TRUE(stats.tt_hits > 0);
+    ASSERT_TRUE(stats.tt_overwrites <= stats.tt_stores);
+}
+
+typedef struct {
+    TranspositionTable *table;
+    const char *moves;
+    int score;
+} SharedSolve;
+
+static void *shared_solve_thread(void *arg) {
+    SharedSolve *job = (SharedSolve *)arg;
+    Solver solver;
+
+    solver_init_shared(&solver, job->table);
+    if (!solve_moves(&solver, job->moves, &job->score)) {
+        job->score = 99;
+    }
+    return NULL;
+}
+
+UTEST(solver, shared_table) {
+    TranspositionTable table;
+    pthread_t threads[4];
+    SharedSolve jobs[4] = {
+        {&table, "2266661263422571", 0},
+        {&table, "57163114336634611373", 0},
+        {&table, "31572771356127622466", 0},
+        {&table, "2266661263422571", 0},
+    };
+
+    ASSERT_EQ(solver_table_init(&table, 18, TABLE_TWO_TIER), 1);
+    for (int i = 0; i < 4; i++) {
+        ASSERT_EQ(pthread_create(&threads[i], NULL, shared_solve_thread, &jobs[i]), 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    ASSERT_EQ(jobs[0].score, -2);
+    ASSERT_EQ(jobs[1].score, 3);
+    ASSERT_EQ(jobs[2].score, 2);
+    ASSERT_EQ(jobs[3].score, -2);
+    solver_table_free(&table);
+}
@@ -0,0 +1,122 @@
+#include "utest.h"
+#include "tablebase.h"
+#include "solver.h"
+#include "board.h"
+#include "ai.h"
+#include <stdio.h>
+
+#define TEST_TABLEBASE "test_tablebase.c4tb"
+
+static TablebaseValue solver_value(Solver *solver, const Board *board, CellState to_move) {
+    Position position;
+    int score = 0;
+
+    solver_position_from_board(&position, board, to_move);
+    solver_solve(solver, &position, &score);
+    return score > 0 ? TABLEBASE_WIN : (score < 0 ? TABLEBASE_LOSS : TABLEBASE_DRAW);
+}
+
+static void mirror_board(const Board *board, Board *mirrored) {
+    board_init_config(mirrored, &(BoardConfig){board->rows, board->cols, board->connect});
+    for (int row = 0; row < board->rows; row++) {
+        for (int col = 0; col < board->cols; col++) {
+            board_set_cell(mirrored, row, board->cols - 1 - col, (CellState)board->cells[row][col]);
+        }
+    }
+}
+
+UTEST(tablebase, matches_solver) {
+    static const char *root_moves = "6221173733751455526776556";
+    static const char *lines[] = {"", "4", "44", "17", "2", "62", "3", "71", "21", "66"};
+    Tablebase tablebase;
+    Solver solver;
+    Board root;
+    CellState to_move;
+
+    ASSERT_EQ(board_play_moves(&root, root_moves, &to_move), 25);
+    ASSERT_EQ(tablebase_generate(&tablebase, &root, to_move, 17), 1);
+    ASSERT_EQ(tablebase.positions, tablebase_size(&root, 17));
+    ASSERT_EQ(solver_init(&solver, 18), 1);
+
+    // games still going below the root, and their mirror images, against the exact solver
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        char moves[64];
+        Board board;
+        Board mirrored;
+        CellState next;
+
+        snprintf(moves, sizeof(moves), "%s%s", root_moves, lines[i]);
+        ASSERT_TRUE(board_play_moves(&board, moves, &next) > 0);
+        TablebaseValue expected = solver_value(&solver, &board, next);
+        ASSERT_EQ(tablebase_probe(&tablebase, &board, next), expected);
+        mirror_board(&board, &mirrored);
+        ASSERT_EQ(tablebase_probe(&tablebase, &mirrored, next), expected);
+    }
+
+    // not below the root, or the wrong player to move
+    Board other;
+    CellState other_to_move;
+    ASSERT_EQ(board_play_moves(&other, "44", &other_to_move), 2);
+    ASSERT_EQ(tablebase_probe(&tablebase, &other, other_to_move), TABLEBASE_MISSING);
+    ASSERT_EQ(tablebase_probe(&tablebase, &root, to_move == PLAYER1 ? PLAYER2 : PLAYER1), TABLEBASE_MISSING);
+
+    solver_free(&solver);
+    tablebase_free(&tablebase);
+}
+
+UTEST(tablebase, save_and_load) {
+    BoardConfig config;
+    Tablebase built;
+    Tablebase loaded;
+    Board board;
+    CellState to_move;
+
+    // 4x4 is a draw, and small enough to solve from the empty board
+    ASSERT_EQ(board_config_parse("4x4", &config), 1);
+    ASSERT_EQ(board_init_config(&board, &config), 1);
+    ASSERT_EQ(tablebase_generate(&built, &board, PLAYER1, 16), 1);
+    ASSERT_EQ(tablebase_probe(&built, &board, PLAYER1), TABLEBASE_DRAW);
+
+    ASSERT_EQ(tablebase_save(&built, TEST_TABLEBASE), 1);
+    ASSERT_EQ(tablebase_load(&loaded, TEST_TABLEBASE), 1);
+    ASSERT_EQ(loaded.positions, built.positions);
+    ASSERT_EQ(board_play_moves_config(&board, &config, "2332", &to_move), 4);
+    ASSERT_EQ(tablebase_probe(&loaded, &board, to_move), tablebase_probe(&built, &board, to_move));
+
+    // a standard board is another geometry
+    board_init(&board);
+    ASSERT_EQ(tablebase_probe(&loaded, &board, PLAYER1), TABLEBASE_MISSING);
+
+    tablebase_free(&built);
+    tablebase_free(&loaded);
+    remove(TEST_TABLEBASE);
+    ASSERT_EQ(tablebase_load(&loaded, TEST_TABLEBASE), 0);
+}
+
+UTEST(tablebase, perfect_level_probes) {
+    BoardConfig config;
+    Tablebase tablebase;
+    Board board;
+    Board child;
+    CellState to_move;
+    SearchResult result;
+
+    // the solver does not handle 5x4, the deepening search finds the table's win
+    ASSERT_EQ(board_config_parse("5x4", &config), 1);
+    ASSERT_EQ(board_init_config(&board, &config), 1);
+    ASSERT_EQ(tablebase_generate(&tablebase, &board, PLAYER1, 20), 1);
+    ASSERT_EQ(board_play_moves_config(&board, &config, "1", &to_move), 1);
+    ASSERT_EQ(tablebase_probe(&tablebase, &board, to_move), TABLEBASE_WIN);
+
+    ai_set_tablebase(&tablebase);
+    int column = ai_search(&board, to_move, AI_PERFECT, &result);
+    ai_set_tablebase(NULL);
+
+    child = board;
+    ASSERT_TRUE(board_drop_piece(&child, column, to_move) >= 0);
+    CellState opponent = (to_move == PLAYER1) ? PLAYER2 : PLAYER1;
+    ASSERT_EQ(tablebase_probe(&tablebase, &child, opponent), TABLEBASE_LOSS);
+    ASSERT_TRUE(result.stats.tablebase_hits > 0);
+
+    tablebase_free(&tablebase);
+}
@@ -0,0 +1,127 @@
+#include "utest.h"
+#include "threat.h"
+#include "board.h"
+
+// Heights are counted from the bottom, 0-based
+static void place(Board *board, int col, int height, CellState player) {
+    board_set_cell(board, board->rows - 1 - height, col, player);
+}
+
+UTEST(threat, parity_and_playable) {
+    Board board;
+    ThreatMap map;
+
+    // X on the bottom row in columns 2-4 threatens both ends of it
+    board_init(&board);
+    place(&board, 1, 0, PLAYER1);
+    place(&board, 2, 0, PLAYER1);
+    place(&board, 3, 0, PLAYER1);
+    threat_analyze(&board, &map);
+
+    const PlayerThreats *x = threat_player(&map, PLAYER1);
+    ASSERT_EQ(threat_count(x->all), 2);
+    ASSERT_TRUE(x->odd == x->all);
+    ASSERT_TRUE(x->even == 0);
+    ASSERT_TRUE(x->playable == x->all);
+    ASSERT_TRUE((x->all & board_cell_bit(&board, ROWS - 1, 0)) != 0);
+    ASSERT_TRUE((x->all & board_cell_bit(&board, ROWS - 1, 4)) != 0);
+    ASSERT_EQ(threat_is_double(&board, &map, PLAYER1), 1);
+    ASSERT_TRUE(threat_player(&map, PLAYER2)->all == 0);
+    ASSERT_EQ(threat_is_double(&board, &map, PLAYER2), 0);
+}
+
+UTEST(threat, stacked_threats) {
+    Board board;
+    ThreatMap map;
+
+    // O closes the right end of both rows, X threatens column 1 twice, one above the other
+    board_init(&board);
+    for (int height = 0; height < 2; height++) {
+        place(&board, 1, height, PLAYER1);
+        place(&board, 2, height, PLAYER1);
+        place(&board, 3, height, PLAYER1);
+        place(&board, 4, height, PLAYER2);
+    }
+    threat_analyze(&board, &map);
+
+    const PlayerThreats *x = threat_player(&map, PLAYER1);
+    ASSERT_EQ(threat_count(x->all), 2);
+    ASSERT_EQ(threat_count(x->playable), 1);
+    ASSERT_EQ(threat_count(x->odd), 1);
+    ASSERT_EQ(threat_count(x->even), 1);
+    ASSERT_EQ(threat_is_double(&board, &map, PLAYER1), 1);
+}
+
+UTEST(threat, live_threats_and_score) {
+    Board board;
+    ThreatMap map;
+
+    // O fills the bottom row under X, so O's row 1 threats sit below X's row 2 ones
+    board_init(&board);
+    for (int col = 1; col <= 3; col++) {
+        place(&board, col, 0, PLAYER2);
+        place(&board, col, 1, PLAYER1);
+    }
+    threat_analyze(&board, &map);
+
+    const PlayerThreats *x = threat_player(&map, PLAYER1);
+    const PlayerThreats *o = threat_player(&map, PLAYER2);
+    ASSERT_EQ(threat_count(x->all), 2);
+    ASSERT_TRUE(x->live == 0);
+    ASSERT_EQ(threat_count(o->live), 2);
+    ASSERT_TRUE(o->live == o->odd);
+
+    // equal stone counts: whoever is to move started the game
+    ASSERT_EQ(threat_first_player(&board, PLAYER1), PLAYER1);
+    ASSERT_EQ(threat_first_player(&board, PLAYER2), PLAYER2);
+
+    // odd threats only help the first player
+    ASSERT_EQ(threat_score(&board, &map, PLAYER1, PLAYER1), 0);
+    ASSERT_TRUE(threat_score(&board, &map, PLAYER2, PLAYER2) > threat_score(&board, &map, PLAYER2, PLAYER1));
+    ASSERT_TRUE(threat_score(&board, &map, PLAYER2, PLAYER1) > 0);
+
+    // seven rows: no parity bonus either way
+    BoardConfig config = {7, 8, 4};
+    board_init_config(&board, &config);
+    for (int col = 1; col <= 3; col++) {
+        place(&board, col, 0, PLAYER2);
+    }
+    threat_analyze(&board, &map);
+    ASSERT_EQ(threat_score(&board, &map, PLAYER2, PLAYER2), threat_score(&board, &map, PLAYER2, PLAYER1));
+}
+
+UTEST(threat, non_losing_moves) {
+    Board board;
+    ThreatMap map;
+
+    // O threatens row 2 in columns 1 and 5: X must not fill the cells below
+    board_init(&board);
+    place(&board, 1, 0, PLAYER1);
+    place(&board, 2, 0, PLAYER1);
+    place(&board, 3, 0, PLAYER2);
+    for (int col = 1; col <= 3; col++) {
+        place(&board, col, 1, PLAYER2);
+    }
+    threat_analyze(&board, &map);
+
+    Bitboard moves = threat_non_losing_moves(&board, &map, PLAYER1);
+    ASSERT_EQ(threat_count(moves), 5);
+    ASSERT_TRUE((moves & board_column_cells(&board, 0)) == 0);
+    ASSERT_TRUE((moves & board_column_cells(&board, 4)) == 0);
+
+    // one playable O threat: the block is the only move
+    board_init(&board);
+    for (int col = 1; col <= 3; col++) {
+        place(&board, col, 0, PLAYER2);
+        place(&board, col, 1, PLAYER1);
+    }
+    place(&board, 4, 0, PLAYER1);
+    threat_analyze(&board, &map);
+    moves = threat_non_losing_moves(&board, &map, PLAYER1);
+    ASSERT_TRUE(moves == board_cell_bit(&board, ROWS - 1, 0));
+
+    // two of them: every move loses
+    board_set_cell(&board, ROWS - 1, 4, EMPTY);
+    threat_analyze(&board, &map);
+    ASSERT_TRUE(threat_non_losing_moves(&board, &map, PLAYER1) == 0);
+}